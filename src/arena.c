@@ -0,0 +1,271 @@
+#include "error.h"
+#include "internal.h"
+#include "logging.h"
+#include "print.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+#define MAPPED_ARENA
+#endif
+
+static void
+report_resized (kissat * solver, const char *mode, arena before)
+{
+#ifndef QUIET
+  ward *const old_begin = BEGIN_STACK (before);
+  ward *const new_begin = BEGIN_STACK (solver->arena);
+  const bool moved = (new_begin != old_begin);
+  const uint64_t capacity = CAPACITY_STACK (solver->arena);
+  const uint64_t bytes = capacity * sizeof (ward);
+  kissat_phase (solver, "arena", GET (arena_resized),
+		"%s to %s %d-byte-words %s (%s)", mode,
+		FORMAT_COUNT (capacity),
+		(int) sizeof (ward),
+		FORMAT_BYTES (bytes), (moved ? "moved" : "in place"));
+#else
+  (void) solver;
+  (void) mode;
+  (void) before;
+#endif
+}
+
+#ifdef MAPPED_ARENA
+
+// Instead of doubling the arena with 'realloc', which copies all clauses
+// and needs twice the memory while doing so, the address space of the
+// largest possible arena is reserved once as inaccessible mapping, which
+// costs no memory yet.  Enlarging only makes more of it accessible and
+// thus never moves the arena.  The mapping is aligned to huge pages and,
+// unless disabled with '--no-arenahuge', the kernel is asked to back it
+// by transparent huge pages, which reduces TLB misses when propagation
+// accesses clauses scattered over an arena of several gigabytes.
+
+#define HUGE_PAGE_BYTES ((size_t) 1 << 21)
+#define MAPPED_ARENA_BYTES (MAX_ARENA * sizeof (ward))
+
+static bool
+map_arena (kissat * solver)
+{
+  assert (!solver->mapped_arena);
+  assert (!CAPACITY_STACK (solver->arena));
+  if (!GET_OPTION (arenamap))
+    return false;
+  if (sizeof (word) < 8)
+    return false;
+  const size_t bytes = MAPPED_ARENA_BYTES + HUGE_PAGE_BYTES;
+  char *const reserved = mmap (0, bytes, PROT_NONE,
+			       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			       -1, 0);
+  if (reserved == MAP_FAILED)
+    {
+      kissat_verbose (solver, "could not reserve %s of address space "
+		      "for the arena", FORMAT_BYTES (MAPPED_ARENA_BYTES));
+      return false;
+    }
+  const uintptr_t mask = HUGE_PAGE_BYTES - 1;
+  char *const begin = (char *) (((uintptr_t) reserved + mask) & ~mask);
+  char *const end = begin + MAPPED_ARENA_BYTES;
+  if (begin != reserved)
+    munmap (reserved, begin - reserved);
+  if (end != reserved + bytes)
+    munmap (end, reserved + bytes - end);
+#ifdef MADV_HUGEPAGE
+  if (GET_OPTION (arenahuge))
+    madvise (begin, MAPPED_ARENA_BYTES, MADV_HUGEPAGE);
+#endif
+  solver->arena.begin = solver->arena.end = (ward *) begin;
+  solver->arena.allocated = (ward *) begin;
+  solver->mapped_arena = true;
+  kissat_verbose (solver, "reserved %s of address space for the arena",
+		  FORMAT_BYTES (MAPPED_ARENA_BYTES));
+  return true;
+}
+
+static void
+enlarge_mapped_arena (kissat * solver)
+{
+  assert (solver->mapped_arena);
+  char *const begin = (char *) BEGIN_STACK (solver->arena);
+  const size_t old_bytes = CAPACITY_STACK (solver->arena) * sizeof (ward);
+  const size_t new_bytes = old_bytes ? 2 * old_bytes : HUGE_PAGE_BYTES;
+  assert (new_bytes <= MAPPED_ARENA_BYTES);
+  if (mprotect (begin + old_bytes, new_bytes - old_bytes,
+		PROT_READ | PROT_WRITE))
+    kissat_fatal ("out of memory enlarging mapped arena "
+		  "from %zu to %zu bytes", old_bytes, new_bytes);
+  solver->arena.allocated = (ward *) (begin + new_bytes);
+}
+
+// The released part stays reserved but its pages are given back.
+
+static void
+shrink_mapped_arena (kissat * solver)
+{
+  assert (solver->mapped_arena);
+  const size_t size = SIZE_STACK (solver->arena);
+  const size_t old_capacity = CAPACITY_STACK (solver->arena);
+  size_t new_capacity = HUGE_PAGE_BYTES / sizeof (ward);
+  while (new_capacity < size)
+    new_capacity *= 2;
+  if (new_capacity >= old_capacity)
+    return;
+  char *const tail = (char *) (BEGIN_STACK (solver->arena) + new_capacity);
+  const size_t bytes = (old_capacity - new_capacity) * sizeof (ward);
+  madvise (tail, bytes, MADV_DONTNEED);
+  mprotect (tail, bytes, PROT_NONE);
+  solver->arena.allocated = (ward *) tail;
+}
+
+#endif
+
+static void
+enlarge_arena (kissat * solver)
+{
+#ifdef MAPPED_ARENA
+  if (solver->mapped_arena)
+    {
+      enlarge_mapped_arena (solver);
+      return;
+    }
+#endif
+  kissat_stack_enlarge (solver, (chars *) & solver->arena, sizeof (ward));
+}
+
+void
+kissat_reserve_arena (kissat * solver, size_t needed)
+{
+  const size_t size = SIZE_STACK (solver->arena);
+  size_t capacity = CAPACITY_STACK (solver->arena);
+  assert (kissat_is_power_of_two (MAX_ARENA));
+  assert (capacity <= MAX_ARENA);
+  size_t available = capacity - size;
+  if (needed <= available)
+    return;
+  const arena before = solver->arena;
+#ifdef MAPPED_ARENA
+  if (!capacity && !solver->mapped_arena)
+    map_arena (solver);
+#endif
+  do
+    {
+      assert (kissat_is_zero_or_power_of_two (capacity));
+      if (capacity == MAX_ARENA)
+	kissat_fatal ("maximum arena capacity "
+		      "of 2^%u %zu-byte-words %s exhausted"
+#ifdef COMPACT
+		      " (consider a configuration without '--compact')"
+#elif !defined(LARGE_ARENA)
+		      " (consider a configuration with '-DLARGE_ARENA')"
+#endif
+		      ,
+		      LD_MAX_ARENA, sizeof (ward),
+		      FORMAT_BYTES (MAX_ARENA * sizeof (ward)));
+      enlarge_arena (solver);
+      capacity = CAPACITY_STACK (solver->arena);
+      available = capacity - size;
+    }
+  while (needed > available);
+  INC (arena_resized);
+  INC (arena_enlarged);
+  report_resized (solver, "enlarged", before);
+  assert (capacity <= MAX_ARENA);
+}
+
+reference
+kissat_allocate_clause (kissat * solver, size_t size)
+{
+  assert (size <= UINT_MAX);
+  const size_t res = SIZE_STACK (solver->arena);
+  assert (res <= MAX_REF);
+  const size_t bytes = kissat_bytes_of_clause (size);
+  assert (kissat_aligned_word (bytes));
+  const size_t needed = bytes / sizeof (ward);
+  assert (needed <= UINT_MAX);
+  kissat_reserve_arena (solver, needed);
+  solver->arena.end += needed;
+  LOG ("allocated clause[%zu] of size %zu bytes %s",
+       res, size, FORMAT_BYTES (bytes));
+  return (reference) res;
+}
+
+void
+kissat_shrink_arena (kissat * solver)
+{
+  const arena before = solver->arena;
+  const size_t capacity = CAPACITY_STACK (before);
+  const size_t size = SIZE_STACK (before);
+#ifndef QUIET
+  const size_t capacity_bytes = capacity * sizeof (ward);
+  kissat_phase (solver, "arena", GET (arena_resized),
+		"capacity of %s %d-byte-words %s",
+		FORMAT_COUNT (capacity), (int) sizeof (ward),
+		FORMAT_BYTES (capacity_bytes));
+  const size_t size_bytes = size * sizeof (ward);
+  kissat_phase (solver, "arena", GET (arena_resized),
+		"filled %.0f%% with %s %d-byte-words %s",
+		kissat_percent (size, capacity),
+		FORMAT_COUNT (size), (int) sizeof (ward),
+		FORMAT_BYTES (size_bytes));
+#endif
+  if (size > capacity / 4)
+    {
+      kissat_phase (solver, "arena", GET (arena_resized),
+		    "not shrinking since more than 25%% filled");
+      return;
+    }
+#ifdef MAPPED_ARENA
+  if (solver->mapped_arena && capacity <= HUGE_PAGE_BYTES / sizeof (ward))
+    {
+      kissat_phase (solver, "arena", GET (arena_resized),
+		    "not shrinking mapped arena below huge page");
+      return;
+    }
+#endif
+  INC (arena_resized);
+  INC (arena_shrunken);
+#ifdef MAPPED_ARENA
+  if (solver->mapped_arena)
+    shrink_mapped_arena (solver);
+  else
+#endif
+    SHRINK_STACK (solver->arena);
+  report_resized (solver, "shrunken", before);
+}
+
+void
+kissat_release_arena (kissat * solver)
+{
+#ifdef MAPPED_ARENA
+  if (solver->mapped_arena)
+    {
+      munmap (BEGIN_STACK (solver->arena), MAPPED_ARENA_BYTES);
+      INIT_STACK (solver->arena);
+      solver->mapped_arena = false;
+      return;
+    }
+#endif
+  RELEASE_STACK (solver->arena);
+}
+
+#if !defined(NDEBUG) || defined(LOGGING)
+
+bool
+kissat_clause_in_arena (const kissat * solver, const clause * c)
+{
+  if (!kissat_aligned_pointer (c))
+    return false;
+  const char *p = (char *) c;
+  const char *begin = (char *) BEGIN_STACK (solver->arena);
+  const char *end = (char *) END_STACK (solver->arena);
+  if (p < begin)
+    return false;
+  const size_t bytes = kissat_bytes_of_clause (c->size);
+  if (end < p + bytes)
+    return false;
+  return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _arena_h_INCLUDED
+#define _arena_h_INCLUDED
+
+#include "reference.h"
+#include "stack.h"
+#include "utilities.h"
+
+// References are 31-bit offsets of 'ward' sized slots into the arena.
+// This keeps large clause watches at two words and reasons at one, but
+// limits the arena to 2^31 wards, i.e., to 16 GB with '--compact' and to
+// 32 GB by default.  Configuring with '-DLARGE_ARENA' (CMake option
+// 'LARGE_ARENA') doubles the size of a ward and thus the reachable arena
+// to 64 GB, at the cost of padding clauses to 32 bytes.  This is still a
+// hard limit.  A clause of size 'k' takes '12 + 4k' bytes rounded up to
+// a multiple of 32, so 64 GB hold for instance about 6 billion literals
+// in clauses of size three or 14 billion in clauses of size 13, which
+// has to cover learned clauses too.  Larger formulas would need wider or
+// segmented references.
+
+#if defined(COMPACT) && defined(LARGE_ARENA)
+#error "can not combine 'COMPACT' and 'LARGE_ARENA'"
+#endif
+
+#if defined(COMPACT)
+typedef word ward;
+#elif defined(LARGE_ARENA)
+typedef w4rd ward;
+#else
+typedef w2rd ward;
+#endif
+
+#define LD_MAX_ARENA_32 (29 -  (unsigned) sizeof (ward)/4)
+
+#define LD_MAX_ARENA \
+  ((sizeof (word) == 4) ? LD_MAX_ARENA_32 : LD_MAX_REF)
+
+#define MAX_ARENA ((size_t)1 << LD_MAX_ARENA)
+
+// *INDENT-OFF*
+
+typedef STACK (ward) arena;
+
+// *INDENT-ON*
+
+struct clause;
+struct kissat;
+
+reference kissat_allocate_clause (struct kissat *, size_t size);
+void kissat_reserve_arena (struct kissat *, size_t needed);
+void kissat_shrink_arena (struct kissat *);
+void kissat_release_arena (struct kissat *);
+
+#if !defined(NDEBUG) || defined(LOGGING)
+
+bool kissat_clause_in_arena (const struct kissat *, const struct clause *);
+
+#endif
+
+static inline word
+kissat_align_ward (word w)
+{
+#if defined(COMPACT)
+  return kissat_align_word (w);
+#elif defined(LARGE_ARENA)
+  return kissat_align_w4rd (w);
+#else
+  return kissat_align_w2rd (w);
+#endif
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef _assign_h_INCLUDED
+#define _assign_h_INCLUDED
+
+#include "literal.h"
+
+#include <stdbool.h>
+
+#define DECISION_REASON	UINT_MAX
+#define UNIT_REASON	(DECISION_REASON - 1)
+
+#define INVALID_LEVEL UINT_MAX
+
+typedef struct analysis analysis;
+typedef struct assigned assigned;
+struct clause;
+
+// Propagation only writes and reads the 'assigned' records, while the
+// flags in 'analysis' are only touched during conflict analysis, clause
+// minimization, shrinking and vivification, and are all reset afterwards.
+// Keeping them apart saves a quarter of the per-variable memory accessed
+// during propagation.  Trail positions are bounded by the number of
+// variables and thus leave room for the two flags of binary reasons.
+
+struct assigned
+{
+  unsigned level;
+  unsigned trail:LD_MAX_VAR;
+  bool binary:1;
+  bool redundant:1;
+  unsigned reason;
+};
+
+struct analysis
+{
+  bool analyzed:1;
+  bool poisoned:1;
+  bool removable:1;
+  bool shrinkable:1;
+};
+
+#define ASSIGNED(LIT) \
+  (assert (VALID_INTERNAL_LITERAL (LIT)), \
+   solver->assigned + IDX (LIT))
+
+#define ANALYSIS(LIT) \
+  (assert (VALID_INTERNAL_LITERAL (LIT)), \
+   solver->analysis + IDX (LIT))
+
+#define LEVEL(LIT) \
+  (ASSIGNED(LIT)->level)
+
+#define REASON(LIT) \
+  (ASSIGNED(LIT)->reason)
+
+#ifndef FAST_ASSIGN
+
+#include "reference.h"
+
+struct kissat;
+struct clause;
+
+void kissat_assign_unit (struct kissat *, unsigned lit, const char *);
+void kissat_learned_unit (struct kissat *, unsigned lit);
+void kissat_original_unit (struct kissat *, unsigned lit);
+
+void kissat_assign_decision (struct kissat *, unsigned lit);
+
+void kissat_assign_binary (struct kissat *, bool, unsigned, unsigned);
+
+void kissat_assign_reference (struct kissat *, unsigned lit,
+			      reference, struct clause *);
+
+#endif
+
+#endif
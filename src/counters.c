@@ -0,0 +1,183 @@
+#include "counters.h"
+
+#include "allocate.h"
+#include "inline.h"
+#include "print.h"
+
+#include <string.h>
+
+static void
+enlarge_counters (kissat * solver, counted_clauses * counters, unsigned size)
+{
+  assert (counters->size < size);
+  counters->counted = kissat_nrealloc (solver, counters->counted,
+				       counters->size, size,
+				       sizeof *counters->counted);
+  memset (counters->counted + counters->size, 0,
+	  (size - counters->size) * sizeof *counters->counted);
+  const unsigned old_lits = 2 * counters->size, new_lits = 2 * size;
+  counters->occurrences = kissat_nrealloc (solver, counters->occurrences,
+					   old_lits, new_lits,
+					   sizeof *counters->occurrences);
+  memset (counters->occurrences + old_lits, 0,
+	  (new_lits - old_lits) * sizeof *counters->occurrences);
+  counters->size = size;
+}
+
+// Literals count as false for a clause only after their counters were
+// updated during propagation, i.e., if their variable is 'counted'.
+
+static void
+count_clause (kissat * solver, counted_clauses * counters,
+	      const clause * c, reference ref)
+{
+  assert (kissat_counted_clause (c));
+  const value *const values = solver->values;
+  const bool *const counted = counters->counted;
+  const unsigned pos = SIZE_STACK (counters->counters);
+  unsigned count = 0, sum = 0;
+  for (all_literals_in_clause (lit, c))
+    {
+      if (values[lit] < 0 && counted[IDX (lit)])
+	continue;
+      count++;
+      sum += lit;
+    }
+  const clause_counter counter = {.count = count,.dead = false,.sum = sum,
+    .ref = ref
+  };
+  PUSH_STACK (counters->counters, counter);
+  for (all_literals_in_clause (lit, c))
+    PUSH_STACK (counters->occurrences[lit], pos);
+}
+
+void
+kissat_count_clause (kissat * solver, reference ref)
+{
+  counted_clauses *const counters = solver->counters;
+  if (!counters)
+    return;
+  const clause *const c = kissat_dereference_clause (solver, ref);
+  if (!kissat_counted_clause (c))
+    return;
+  if (counters->size < VARS)
+    enlarge_counters (solver, counters, VARS);
+  LOGREF (ref, "counting");
+  count_clause (solver, counters, c, ref);
+}
+
+void
+kissat_flush_counters (kissat * solver)
+{
+  counted_clauses *const counters = solver->counters;
+  if (!counters)
+    return;
+  LOG ("flushing clause counters");
+  for (unsigned lit = 0; lit < 2 * counters->size; lit++)
+    CLEAR_STACK (counters->occurrences[lit]);
+  CLEAR_STACK (counters->counters);
+  memset (counters->counted, 0, counters->size * sizeof *counters->counted);
+}
+
+// All assigned variables are considered propagated here.  This holds for
+// rebuilding after collecting garbage during reduction and on the
+// root-level otherwise, where the regular watches of counted clauses are
+// still propagated and find units missed this way.
+
+void
+kissat_count_clauses (kissat * solver)
+{
+  counted_clauses *const counters = solver->counters;
+  if (!counters)
+    return;
+  assert (solver->watching);
+  assert (!solver->level || kissat_propagated (solver));
+  kissat_flush_counters (solver);
+  if (counters->size < VARS)
+    enlarge_counters (solver, counters, VARS);
+  const value *const values = solver->values;
+  bool *const counted = counters->counted;
+  for (all_variables (idx))
+    counted[idx] = (values[LIT (idx)] != 0);
+  ward *const arena = BEGIN_STACK (solver->arena);
+  for (all_clauses (c))
+    {
+      if (c->garbage)
+	continue;
+      if (!kissat_counted_clause (c))
+	continue;
+      count_clause (solver, counters, c, (ward *) c - arena);
+    }
+  LOG ("counting %zu clauses", SIZE_STACK (counters->counters));
+}
+
+// Counters pay off for short clauses in which literals occur often, i.e.,
+// for dense formulas.  Otherwise most counter updates are wasted compared
+// to skipping clauses through blocking literals and watches which are not
+// even visited.  The decision is made once per instance on the counted
+// (irredundant large) clauses, unless forced with '--counters=1'.
+
+static bool
+select_counters (kissat * solver, counted_clauses * counters)
+{
+  const size_t clauses = SIZE_STACK (counters->counters);
+  if (!clauses)
+    return false;
+  size_t occurrences = 0, literals = 0;
+  for (unsigned lit = 0; lit < 2 * counters->size; lit++)
+    {
+      const size_t size = SIZE_STACK (counters->occurrences[lit]);
+      if (!size)
+	continue;
+      occurrences += size;
+      literals++;
+    }
+  const double length = occurrences / (double) clauses;
+  const double density = occurrences / (double) literals;
+  kissat_verbose (solver, "counted clauses average length %.2f "
+		  "and %.2f occurrences per literal", length, density);
+  const int mode = GET_OPTION (counters);
+  if (mode == 1)
+    return true;
+  if (length > GET_OPTION (counterslength))
+    return false;
+  if (density < GET_OPTION (countersdensity))
+    return false;
+  return true;
+}
+
+void
+kissat_init_counters (kissat * solver)
+{
+  if (!GET_OPTION (counters))
+    return;
+  if (!solver->watching)
+    return;
+  assert (!solver->counters);
+  solver->counters = kissat_calloc (solver, 1, sizeof *solver->counters);
+  kissat_count_clauses (solver);
+  if (select_counters (solver, solver->counters))
+    {
+      kissat_verbose (solver, "using counter-based propagation");
+      kissat_tag_separate_watches (solver);
+    }
+  else
+    kissat_release_counters (solver);
+}
+
+void
+kissat_release_counters (kissat * solver)
+{
+  counted_clauses *const counters = solver->counters;
+  if (!counters)
+    return;
+  for (unsigned lit = 0; lit < 2 * counters->size; lit++)
+    RELEASE_STACK (counters->occurrences[lit]);
+  kissat_dealloc (solver, counters->occurrences, 2 * counters->size,
+		  sizeof *counters->occurrences);
+  kissat_dealloc (solver, counters->counted, counters->size,
+		  sizeof *counters->counted);
+  RELEASE_STACK (counters->counters);
+  kissat_free (solver, counters, sizeof *counters);
+  solver->counters = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef _counters_h_INCLUDED
+#define _counters_h_INCLUDED
+
+#include "clause.h"
+#include "reference.h"
+#include "stack.h"
+
+#include <stdbool.h>
+
+// Counter-based propagation of irredundant large clauses, as in the
+// 'NWATCHES' variant of SATCH, selected per instance (see '--counters').
+// Instead of two watches each clause keeps the number 'count' and the
+// 'sum' of its literals not yet propagated as false.  Propagating a
+// literal to false decrements the counters of all clauses in its
+// occurrence list, so as soon as 'count' drops to one the remaining
+// literal is 'sum' and is either true, implied or conflicting.  This is
+// cheaper than searching for replacement literals if clauses are short
+// and literals occur often, but backtracking has to undo these updates
+// (see 'uncount_literal' in 'backtrack.c').
+//
+// Whether the counters of a variable were updated is recorded in
+// 'counted', because propagation can stop early on conflicts and
+// chronological backtracking keeps literals assigned which are then
+// propagated again.  As for ternary clauses (see 'ternary.h') the clauses
+// stay in the arena and keep their regular watches, which are tagged as
+// 'separate' and skipped during propagation except on the root-level.
+// Clauses shrunken in place are not counted and their counter is only
+// dropped when the clause becomes a reason or conflict.  The counters are
+// rebuilt whenever the arena is collected or all large clauses are
+// watched again and flushed together with large clause watches.
+
+typedef struct counted_clauses counted_clauses;
+typedef struct clause_counter clause_counter;
+
+struct clause_counter
+{
+  unsigned count:31;
+  bool dead:1;
+  unsigned sum;
+  reference ref;
+};
+
+// *INDENT-OFF*
+typedef STACK (clause_counter) clause_counters;
+// *INDENT-ON*
+
+struct counted_clauses
+{
+  unsigned size;
+  bool *counted;
+  unsigneds *occurrences;
+  clause_counters counters;
+};
+
+struct kissat;
+
+static inline bool
+kissat_counted_clause (const clause * c)
+{
+  return !c->redundant && !c->shrunken;
+}
+
+void kissat_init_counters (struct kissat *);
+void kissat_release_counters (struct kissat *);
+
+void kissat_count_clause (struct kissat *, reference);
+void kissat_count_clauses (struct kissat *);
+void kissat_flush_counters (struct kissat *);
+
+#endif
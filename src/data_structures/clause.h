@@ -46,7 +46,7 @@ static inline size_t
 kissat_bytes_of_clause (unsigned size)
 {
   const size_t res = sizeof (clause) + (size - 3) * sizeof (unsigned);
-  return kissat_align_ward (res); // size of clause is a multiple of 8 or 16
+  return kissat_align_ward (res); // size of clause is a multiple of 8, 16 or 32
 }
 
 static inline size_t
@@ -144,6 +144,15 @@ struct kissat
 
   termination termination;
 
+  struct share *share;
+  struct shared_clauses *shared;
+  struct cube *cube;
+  struct window *window;
+  struct vivifier *vivifier;
+  struct walkers *walkers;
+  struct ternary_clauses *ternary;
+  struct counted_clauses *counters;
+
   unsigned vars;
   unsigned size;
   unsigned active;
@@ -155,6 +164,7 @@ struct kissat
   unsigneds witness;
 
   assigned *assigned;
+  analysis *analysis;
   flags *flags;
 
   mark *marks;
@@ -210,10 +220,13 @@ struct kissat
   unsigneds shadow;
 
   arena arena;
+  bool mapped_arena;
   vectors vectors;
   reference first_reducible;
   reference last_irredundant;
   watches *watches;
+  unsigned *binaries;
+  bool simd_replacement;
 
   sizes sorter;
 
@@ -0,0 +1,546 @@
+#include "checkpoint.h"
+
+#include "../parallel/portfolio.h"
+#include "../parallel/threads.h"
+
+#include "allocate.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+#include "resources.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC "ssatckp1"
+
+// Checkpoints are streamed through a large 'stdio' buffer directly from
+// the solver arrays, which avoids copying and keeps writing fast.
+
+#define SIZE_BUFFER (1u << 20)
+
+static struct
+{
+  const char *path;		// Checkpoint written.
+  const char *resume;		// Checkpoint resumed.
+  double interval;		// Seconds between checkpoints.
+  double next;			// Wall clock time of next checkpoint.
+  uint64_t written;
+} checkpoint = {.interval = 600 };
+
+// The search state is reset by 'start_search' and thus only taken over
+// from the resumed checkpoint after search started.
+
+static struct
+{
+  bool pending;
+  bool stable;
+  averages averages[2];
+  reluctant reluctant;
+  bounds bounds;
+  delays delays;
+  enabled enabled;
+  effort last;
+  limits limits;
+  waiting waiting;
+  unsigned walked;
+  statistics statistics;
+  mode mode;
+  generator random;
+  uint64_t ticks;
+} resumed;
+
+typedef struct header header;
+
+struct header
+{
+  char magic[8];
+  uint32_t sizes[8];
+  uint64_t external;		// External variables plus one.
+  uint64_t vars;		// Internal variables.
+};
+
+static void
+init_header (kissat * solver, header * header)
+{
+  memset (header, 0, sizeof *header);
+  memcpy (header->magic, MAGIC, sizeof header->magic);
+  header->sizes[0] = sizeof (ward);
+  header->sizes[1] = sizeof (assigned);
+  header->sizes[2] = sizeof (flags);
+  header->sizes[3] = sizeof (links);
+  header->sizes[4] = sizeof (import);
+  header->sizes[5] = sizeof (extension);
+  header->sizes[6] = sizeof (limits);
+  header->sizes[7] = sizeof (statistics);
+  header->external = SIZE_STACK (solver->import);
+  header->vars = VARS;
+}
+
+/*------------------------------------------------------------------------*/
+
+static double
+parse_interval (const char *arg, const char *str)
+{
+  char *end;
+  const double res = strtod (str, &end);
+  if (end == str || *end || res <= 0)
+    kissat_error ("invalid checkpoint interval in '%s'", arg);
+  return res;
+}
+
+bool
+kissat_init_checkpoint (int *argc_ptr, char ***argv_ptr)
+{
+  const int argc = *argc_ptr;
+  char **argv = *argv_ptr;
+  int j = 1;
+  for (int i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      if (!strncmp (arg, "--checkpoint=", 13))
+	checkpoint.path = arg + 13;
+      else if (!strncmp (arg, "--checkpoint-interval=", 22))
+	checkpoint.interval = parse_interval (arg, arg + 22);
+      else if (!strncmp (arg, "--resume=", 9))
+	checkpoint.resume = arg + 9;
+      else
+	argv[j++] = argv[i];
+    }
+  argv[j] = 0;
+  *argc_ptr = j;
+  if (!checkpoint.path && !checkpoint.resume)
+    return false;
+  if (kissat_threads () > 1 || kissat_portfolio_cubing ())
+    kissat_error ("checkpoints only work with one solver per rank");
+  checkpoint.next = kissat_wall_clock_time () + checkpoint.interval;
+  return true;
+}
+
+static char *
+rank_path (kissat * solver, const char *path, const char *suffix)
+{
+  const bool ranked = kissat_portfolio_size () > 1;
+  const int rank = kissat_portfolio_rank ();
+#define FORMAT_PATH(BUFFER,BYTES) \
+  (ranked ? snprintf ((BUFFER), (BYTES), "%s.%d%s", path, rank, suffix) \
+          : snprintf ((BUFFER), (BYTES), "%s%s", path, suffix))
+  const size_t bytes = FORMAT_PATH (0, 0) + 1;
+  char *res = kissat_nalloc (solver, bytes, 1);
+  FORMAT_PATH (res, bytes);
+#undef FORMAT_PATH
+  return res;
+}
+
+static void
+release_path (kissat * solver, char *path)
+{
+  kissat_dealloc (solver, path, strlen (path) + 1, 1);
+}
+
+/*------------------------------------------------------------------------*/
+
+#define WRITE_ARRAY(PTR,N) \
+  fwrite ((PTR), sizeof *(PTR), (N), file)
+
+#define WRITE(OBJ) \
+  WRITE_ARRAY (&(OBJ), 1)
+
+#define WRITE_STACK(S) \
+do { \
+  const uint64_t SIZE = SIZE_STACK (S); \
+  WRITE (SIZE); \
+  WRITE_ARRAY (BEGIN_STACK (S), SIZE); \
+} while (0)
+
+static void
+write_binaries (kissat * solver, FILE * file)
+{
+  uint64_t binaries = 0;
+  for (all_literals (lit))
+    for (all_binary_blocking_watches (watch, WATCHES (lit)))
+      if (watch.type.binary && lit < watch.binary.lit)
+	binaries++;
+  WRITE (binaries);
+  for (all_literals (lit))
+    for (all_binary_blocking_watches (watch, WATCHES (lit)))
+      if (watch.type.binary && lit < watch.binary.lit)
+	{
+	  const unsigned other = watch.binary.lit;
+	  const unsigned tagged = 2 * other + watch.binary.redundant;
+	  WRITE (lit);
+	  WRITE (tagged);
+	}
+}
+
+static bool
+write_checkpoint (kissat * solver, FILE * file)
+{
+  header header;
+  init_header (solver, &header);
+  WRITE (header);
+
+  WRITE (solver->active);
+  WRITE (solver->unassigned);
+  WRITE (solver->unflushed);
+  WRITE (solver->best_assigned);
+  WRITE (solver->target_assigned);
+  WRITE (solver->first_reducible);
+  WRITE (solver->last_irredundant);
+  WRITE (solver->scinc);
+
+  const unsigned vars = VARS;
+  WRITE_ARRAY (solver->assigned, vars);
+  WRITE_ARRAY (solver->flags, vars);
+  WRITE_ARRAY (solver->links, vars);
+  WRITE_ARRAY (solver->values, 2 * vars);
+  WRITE_ARRAY (solver->phases.best, vars);
+  WRITE_ARRAY (solver->phases.saved, vars);
+  WRITE_ARRAY (solver->phases.target, vars);
+
+  WRITE_STACK (solver->export);
+  WRITE_STACK (solver->import);
+  WRITE_STACK (solver->extend);
+  WRITE_STACK (solver->units);
+  WRITE_STACK (solver->eliminated);
+  WRITE_STACK (solver->etrail);
+  WRITE_STACK (solver->arena);
+
+  const uint64_t trail = SIZE_ARRAY (solver->trail);
+  const uint64_t propagated =
+    solver->propagate - BEGIN_ARRAY (solver->trail);
+  WRITE (trail);
+  WRITE (propagated);
+  WRITE_ARRAY (BEGIN_ARRAY (solver->trail), trail);
+
+  const heap *const heap = SCORES;
+  WRITE (heap->tainted);
+  WRITE (heap->vars);
+  WRITE_STACK (heap->stack);
+  WRITE_ARRAY (heap->pos, heap->vars);
+  WRITE_ARRAY (heap->score, heap->vars);
+  WRITE (solver->queue);
+
+  write_binaries (solver, file);
+
+  WRITE (solver->stable);
+  WRITE (solver->averages);
+  WRITE (solver->reluctant);
+  WRITE (solver->bounds);
+  WRITE (solver->delays);
+  WRITE (solver->enabled);
+  WRITE (solver->last);
+  WRITE (solver->limits);
+  WRITE (solver->waiting);
+  WRITE (solver->walked);
+  WRITE (solver->statistics);
+  WRITE (solver->mode);
+  WRITE (solver->random);
+  WRITE (solver->ticks);
+
+  return !ferror (file);
+}
+
+void
+kissat_checkpoint (kissat * solver)
+{
+  if (!checkpoint.path)
+    return;
+  assert (!solver->level);
+  if (kissat_checking_or_proving (solver))
+    return;
+  const double start = kissat_wall_clock_time ();
+  if (start < checkpoint.next)
+    return;
+  char *path = rank_path (solver, checkpoint.path, "");
+  char *tmp = rank_path (solver, checkpoint.path, ".tmp");
+  FILE *file = fopen (tmp, "wb");
+  if (!file)
+    kissat_warning (solver, "can not write checkpoint '%s'", tmp);
+  else
+    {
+      setvbuf (file, 0, _IOFBF, SIZE_BUFFER);
+      const bool written = write_checkpoint (solver, file);
+      if (fclose (file) || !written)
+	kissat_warning (solver, "failed to write checkpoint '%s'", tmp);
+      else if (rename (tmp, path))
+	kissat_warning (solver, "failed to rename checkpoint '%s'", tmp);
+      else
+	{
+	  checkpoint.written++;
+	  kissat_verbose (solver, "wrote checkpoint %" PRIu64 " '%s' "
+			  "after %" PRIu64 " conflicts in %.2f seconds",
+			  checkpoint.written, path, CONFLICTS,
+			  kissat_wall_clock_time () - start);
+	}
+    }
+  release_path (solver, tmp);
+  release_path (solver, path);
+  checkpoint.next = kissat_wall_clock_time () + checkpoint.interval;
+}
+
+/*------------------------------------------------------------------------*/
+
+#define READ_ARRAY(PTR,N) \
+  read_bytes (file, (PTR), (N) * sizeof *(PTR))
+
+#define READ(OBJ) \
+  READ_ARRAY (&(OBJ), 1)
+
+#define READ_STACK(S) \
+do { \
+  uint64_t SIZE; \
+  READ (SIZE); \
+  CLEAR_STACK (S); \
+  while (CAPACITY_STACK (S) < SIZE) \
+    kissat_stack_enlarge (solver, (chars *) &(S), sizeof *(S).begin); \
+  READ_ARRAY (BEGIN_STACK (S), SIZE); \
+  (S).end = BEGIN_STACK (S) + SIZE; \
+} while (0)
+
+static void
+read_bytes (FILE * file, void *ptr, size_t bytes)
+{
+  if (bytes && fread (ptr, bytes, 1, file) != 1)
+    kissat_fatal ("truncated checkpoint '%s'", checkpoint.resume);
+}
+
+// All watches are flushed and the arena clauses watched by their first
+// two literals, which is how they were watched when written at a restart.
+
+static void
+rewatch_clauses (kissat * solver, FILE * file)
+{
+  uint64_t binaries;
+  READ (binaries);
+  while (binaries--)
+    {
+      unsigned lit, tagged;
+      READ (lit);
+      READ (tagged);
+      const unsigned other = tagged / 2;
+      if (lit >= LITS || other >= LITS)
+	kissat_fatal ("invalid binary clause in checkpoint '%s'",
+		      checkpoint.resume);
+      kissat_watch_binary (solver, tagged & 1, lit, other);
+    }
+  ward *const arena = BEGIN_STACK (solver->arena);
+  for (all_clauses (c))
+    if (!c->garbage)
+      kissat_watch_reference (solver, c->lits[0], c->lits[1],
+			      (ward *) c - arena);
+  solver->large_clauses_watched_after_binary_clauses = false;
+}
+
+static void
+restore_state (kissat * solver, FILE * file)
+{
+  header expected, header;
+  init_header (solver, &expected);
+  READ (header);
+  if (memcmp (header.magic, expected.magic, sizeof header.magic) ||
+      memcmp (header.sizes, expected.sizes, sizeof header.sizes))
+    kissat_fatal ("incompatible checkpoint '%s'", checkpoint.resume);
+  if (header.external != expected.external || header.vars > solver->size)
+    kissat_fatal ("checkpoint '%s' does not match formula",
+		  checkpoint.resume);
+
+  memset (solver->watches, 0, LITS * sizeof (watches));
+  memset (solver->binaries, 0, LITS * sizeof (unsigned));
+  CLEAR_STACK (solver->vectors.stack);
+  solver->vectors.usable = 0;
+
+  const unsigned vars = header.vars;
+  solver->vars = vars;
+  READ (solver->active);
+  READ (solver->unassigned);
+  READ (solver->unflushed);
+  READ (solver->best_assigned);
+  READ (solver->target_assigned);
+  READ (solver->first_reducible);
+  READ (solver->last_irredundant);
+  READ (solver->scinc);
+
+  READ_ARRAY (solver->assigned, vars);
+  READ_ARRAY (solver->flags, vars);
+  READ_ARRAY (solver->links, vars);
+  READ_ARRAY (solver->values, 2 * vars);
+  READ_ARRAY (solver->phases.best, vars);
+  READ_ARRAY (solver->phases.saved, vars);
+  READ_ARRAY (solver->phases.target, vars);
+  memset (solver->marks, 0, 2 * vars * sizeof (mark));
+
+  READ_STACK (solver->export);
+  READ_STACK (solver->import);
+  READ_STACK (solver->extend);
+  READ_STACK (solver->units);
+  READ_STACK (solver->eliminated);
+  READ_STACK (solver->etrail);
+
+  // The arena might be mapped (see 'arena.c') and can not be reallocated.
+  uint64_t arena_size;
+  READ (arena_size);
+  CLEAR_STACK (solver->arena);
+  kissat_reserve_arena (solver, arena_size);
+  READ_ARRAY (BEGIN_STACK (solver->arena), arena_size);
+  solver->arena.end = BEGIN_STACK (solver->arena) + arena_size;
+
+  uint64_t trail, propagated;
+  READ (trail);
+  READ (propagated);
+  if (trail > vars || propagated > trail)
+    kissat_fatal ("invalid trail in checkpoint '%s'", checkpoint.resume);
+  READ_ARRAY (BEGIN_ARRAY (solver->trail), trail);
+  solver->trail.end = BEGIN_ARRAY (solver->trail) + trail;
+  solver->propagate = BEGIN_ARRAY (solver->trail) + propagated;
+
+  heap *const heap = SCORES;
+  READ (heap->tainted);
+  READ (heap->vars);
+  if (heap->vars > heap->size)
+    kissat_fatal ("invalid heap in checkpoint '%s'", checkpoint.resume);
+  READ_STACK (heap->stack);
+  READ_ARRAY (heap->pos, heap->vars);
+  READ_ARRAY (heap->score, heap->vars);
+  READ (solver->queue);
+
+  rewatch_clauses (solver, file);
+
+  READ (resumed.stable);
+  READ (resumed.averages);
+  READ (resumed.reluctant);
+  READ (resumed.bounds);
+  READ (resumed.delays);
+  READ (resumed.enabled);
+  READ (resumed.last);
+  READ (resumed.limits);
+  READ (resumed.waiting);
+  READ (resumed.walked);
+  READ (resumed.statistics);
+  READ (resumed.mode);
+  READ (resumed.random);
+  READ (resumed.ticks);
+  resumed.pending = true;
+}
+
+void
+kissat_resume_checkpoint (kissat * solver)
+{
+  if (!checkpoint.resume)
+    return;
+  if (solver->inconsistent)
+    return;
+  if (kissat_checking_or_proving (solver))
+    kissat_fatal ("can not resume checkpoint while checking or proving");
+  assert (!solver->level);
+  assert (solver->watching);
+  const double start = kissat_wall_clock_time ();
+  char *path = rank_path (solver, checkpoint.resume, "");
+  FILE *file = fopen (path, "rb");
+  if (!file)
+    kissat_fatal ("can not read checkpoint '%s'", path);
+  setvbuf (file, 0, _IOFBF, SIZE_BUFFER);
+  restore_state (solver, file);
+  if (getc (file) != EOF)
+    kissat_fatal ("trailing data in checkpoint '%s'", path);
+  fclose (file);
+  kissat_message (solver, "resumed checkpoint '%s' with %u variables "
+		  "after %" PRIu64 " conflicts in %.2f seconds", path,
+		  VARS, resumed.statistics.conflicts,
+		  kissat_wall_clock_time () - start);
+  release_path (solver, path);
+}
+
+static void
+restore_smooth (smooth * dst, const smooth * src)
+{
+  dst->value = src->value;
+  dst->biased = src->biased;
+  dst->alpha = src->alpha;
+  dst->beta = src->beta;
+  dst->exp = src->exp;
+}
+
+static void
+restore_averages (averages * dst, const averages * src)
+{
+  dst->initialized = src->initialized;
+  restore_smooth (&dst->fast_glue, &src->fast_glue);
+  restore_smooth (&dst->slow_glue, &src->slow_glue);
+#ifndef QUIET
+  restore_smooth (&dst->level, &src->level);
+  restore_smooth (&dst->size, &src->size);
+  restore_smooth (&dst->trail, &src->trail);
+#endif
+  restore_smooth (&dst->decision_rate, &src->decision_rate);
+  dst->saved_decisions = src->saved_decisions;
+}
+
+// Called right after 'start_search'.  Conflict and decision limits set
+// through the command line as well as the allocation metrics and the
+// timing of the current process are kept.
+
+void
+kissat_resume_search (kissat * solver)
+{
+  if (!resumed.pending)
+    return;
+  resumed.pending = false;
+  if (resumed.stable != solver->stable)
+    {
+#ifndef QUIET
+      if (solver->stable)
+	{
+	  STOP (stable);
+	  START (focused);
+	}
+      else
+	{
+	  STOP (focused);
+	  START (stable);
+	}
+#endif
+      solver->stable = resumed.stable;
+    }
+  restore_averages (solver->averages + 0, resumed.averages + 0);
+  restore_averages (solver->averages + 1, resumed.averages + 1);
+  solver->reluctant = resumed.reluctant;
+  solver->bounds = resumed.bounds;
+  solver->delays = resumed.delays;
+  solver->enabled = resumed.enabled;
+  solver->last = resumed.last;
+  limits *const limits = &solver->limits;
+  const uint64_t conflicts = limits->conflicts;
+  const uint64_t decisions = limits->decisions;
+  *limits = resumed.limits;
+  limits->conflicts = conflicts;
+  limits->decisions = decisions;
+  solver->waiting = resumed.waiting;
+  solver->walked = resumed.walked;
+  statistics *const statistics = &solver->statistics;
+  const uint64_t searches = statistics->searches;
+#ifdef METRICS
+  const uint64_t allocated_current = statistics->allocated_current;
+  const uint64_t allocated_max = statistics->allocated_max;
+#endif
+  *statistics = resumed.statistics;
+  statistics->searches = searches;
+#ifdef METRICS
+  statistics->allocated_current = allocated_current;
+  statistics->allocated_max = allocated_max;
+#endif
+#ifndef QUIET
+  const double entered = solver->mode.entered;
+#endif
+  solver->mode = resumed.mode;
+#ifndef QUIET
+  solver->mode.entered = entered;
+#endif
+  solver->random = resumed.random;
+  solver->ticks = resumed.ticks;
+  kissat_very_verbose (solver, "resumed %s search after %" PRIu64
+		       " conflicts", solver->stable ? "stable" : "focused",
+		       CONFLICTS);
+}
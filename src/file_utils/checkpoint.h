@@ -0,0 +1,27 @@
+#ifndef _checkpoint_h_INCLUDED
+#define _checkpoint_h_INCLUDED
+
+#include <stdbool.h>
+
+struct kissat;
+
+// Running 'ssat --checkpoint=<file> ...' writes the state of the solver
+// to '<file>' at the first restart after '--checkpoint-interval=<sec>'
+// seconds (default 600) passed since the last checkpoint.  The state
+// consists of the clause arena, binary clauses (watches are rebuilt from
+// them and the arena), variable maps, assignments and flags, phases, the
+// scores heap, the queue, the extension stack, limits and statistics.  It
+// is written raw in internal variable order to '<file>.tmp', which is then
+// renamed, so the previous checkpoint survives if the job is killed
+// during writing.  Running 'ssat --resume=<file> ...' on the same formula
+// parses it as usual and then replaces the parsed state by the one in the
+// checkpoint.  In portfolio mode each rank uses '<file>.<rank>'.
+
+bool kissat_init_checkpoint (int *argc_ptr, char ***argv_ptr);
+
+void kissat_resume_checkpoint (struct kissat *);
+void kissat_resume_search (struct kissat *);
+
+void kissat_checkpoint (struct kissat *);
+
+#endif
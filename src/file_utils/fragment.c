@@ -0,0 +1,136 @@
+#include "fragment.h"
+
+#include "../parallel/portfolio.h"
+#include "../parallel/threads.h"
+
+#include "error.h"
+#include "file.h"
+#include "inline.h"
+#include "print.h"
+#include "proof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct fragment fragment;
+
+struct fragment
+{
+  char *path;
+  file file;
+};
+
+// The fragments of all threads are kept here rather than in the solvers,
+// since they outlive the solvers of the threads (thus 'malloc').
+
+static struct
+{
+  const char *path;
+  unsigned size;
+  fragment *fragments;
+} fragments;
+
+bool
+kissat_init_fragments (int *argc_ptr, char ***argv_ptr)
+{
+  const int argc = *argc_ptr;
+  char **argv = *argv_ptr;
+  int j = 1;
+  for (int i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      if (!strncmp (arg, "--fragments=", 12))
+	fragments.path = arg + 12;
+      else
+	argv[j++] = argv[i];
+    }
+  argv[j] = 0;
+  *argc_ptr = j;
+  if (!fragments.path)
+    return false;
+#ifdef NPROOFS
+  kissat_error ("proof fragments require proof support");
+#else
+  if (kissat_portfolio_cubing ())
+    kissat_error ("proof fragments do not work with cubes");
+  fragments.size = kissat_threads ();
+  fragments.fragments = calloc (fragments.size, sizeof (fragment));
+  if (!fragments.fragments)
+    kissat_fatal ("out-of-memory allocating proof fragments");
+  return true;
+#endif
+}
+
+bool
+kissat_fragments (void)
+{
+  return fragments.path != 0;
+}
+
+unsigned
+kissat_fragment_index (int rank, unsigned thread)
+{
+  return rank * kissat_threads () + thread;
+}
+
+#ifndef NPROOFS
+
+void
+kissat_open_fragment (kissat * solver, unsigned thread)
+{
+  if (!fragments.path)
+    return;
+  if (solver->proof)
+    kissat_error ("can not write both a proof and proof fragments");
+  assert (thread < fragments.size);
+  fragment *fragment = fragments.fragments + thread;
+  const unsigned index =
+    kissat_fragment_index (kissat_portfolio_rank (), thread);
+  const size_t bytes = snprintf (0, 0, "%s.%u", fragments.path, index) + 1;
+  fragment->path = malloc (bytes);
+  if (!fragment->path)
+    kissat_fatal ("out-of-memory allocating proof fragment path");
+  snprintf (fragment->path, bytes, "%s.%u", fragments.path, index);
+  if (!kissat_open_to_write_file (&fragment->file, fragment->path))
+    kissat_fatal ("failed to write proof fragment '%s'", fragment->path);
+  kissat_init_proof (solver, &fragment->file, true);
+  kissat_verbose (solver, "writing proof fragment to '%s'", fragment->path);
+}
+
+void
+kissat_close_fragment (kissat * solver, unsigned thread)
+{
+  if (!fragments.path)
+    return;
+  assert (thread < fragments.size);
+  fragment *fragment = fragments.fragments + thread;
+  if (!fragment->path)
+    return;
+  kissat_release_proof (solver);
+  kissat_close_file (&fragment->file);
+  free (fragment->path);
+  fragment->path = 0;
+  if (thread)			// The main solver is closed last.
+    return;
+  free (fragments.fragments);
+  fragments.fragments = 0;
+}
+
+#else
+
+void
+kissat_open_fragment (kissat * solver, unsigned thread)
+{
+  (void) solver;
+  (void) thread;
+}
+
+void
+kissat_close_fragment (kissat * solver, unsigned thread)
+{
+  (void) solver;
+  (void) thread;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _fragment_h_INCLUDED
+#define _fragment_h_INCLUDED
+
+#include <stdbool.h>
+
+struct kissat;
+
+// Running 'ssat --fragments=<path> ...' in parallel (with '--portfolio'
+// ranks, '-t N' threads or both) lets every solver write its own binary
+// DRAT proof fragment to '<path>.<index>', where the index of a solver is
+// 'rank * N + thread'.  Since learned clauses are shared, clauses imported
+// from another solver are traced as 'i' lines with the index of the
+// fragment of the sender (see 'kissat_import_external_to_proof').  The
+// separate 'ssat-merge' tool combines the fragments into one proof which
+// can be checked against the formula as usual (see 'merge.c').
+
+bool kissat_init_fragments (int *argc_ptr, char ***argv_ptr);
+bool kissat_fragments (void);
+
+unsigned kissat_fragment_index (int rank, unsigned thread);
+
+void kissat_open_fragment (struct kissat *, unsigned thread);
+void kissat_close_fragment (struct kissat *, unsigned thread);
+
+#endif
@@ -0,0 +1,557 @@
+// Stand-alone tool 'ssat-merge' combining the binary DRAT proof fragments
+// written by parallel solvers with '--fragments=<path>' (see 'fragment.h')
+// into one binary DRAT proof for the original formula:
+//
+//   ssat-merge <dimacs> <fragment> ... > <proof>
+//
+// Each solver only derives clauses by unit propagation from the original
+// formula, its own clauses and the clauses it imported.  Thus the lines of
+// all fragments can be interleaved to a valid proof as long as every
+// imported clause ('i' lines) is only imported after it was added by some
+// fragment.  Fragments are merged round-robin, each one until it reaches
+// an import of a clause which was not added yet or its end.  Clauses are
+// kept with a reference count over all fragments.  Only the first addition
+// and the last deletion are written.  Original clauses are never deleted,
+// since other solvers might still use them, and neither are imported
+// clauses (found in a first pass over all fragments), since they might be
+// imported again after the sender deleted them.  Merging stops after the
+// first empty clause.
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct clause clause;
+typedef struct fragment fragment;
+typedef struct line line;
+
+struct clause
+{
+  uint64_t hash;
+  size_t offset;		// Position of literals in 'literals'.
+  unsigned size;
+  unsigned count;		// References by fragments.
+  bool pinned;			// Never deleted.
+};
+
+struct line
+{
+  int type;			// 'a', 'd' or 'i' (or 'EOF').
+  unsigned origin;		// Fragment of the sender of 'i' lines.
+  size_t size;
+  size_t capacity;
+  int *lits;
+};
+
+struct fragment
+{
+  const char *path;
+  FILE *file;
+  line line;			// Current line (blocked if 'pending').
+  bool pending;
+  bool finished;
+  uint64_t lines;
+};
+
+static struct
+{
+  clause *table;		// Hash table of clauses.
+  size_t size_table;		// Power of two.
+  size_t clauses;
+  int *literals;
+  size_t size_literals;
+  size_t capacity_literals;
+  uint64_t *imported;		// Hash set of imported clauses.
+  size_t size_imported;		// Power of two.
+  size_t count_imported;
+  FILE *output;
+  struct
+  {
+    uint64_t added;
+    uint64_t deleted;
+    uint64_t imported;
+    uint64_t original;
+    uint64_t skipped;
+  } statistics;
+} merge;
+
+static void
+die (const char *fmt, ...)
+{
+  fputs ("ssat-merge: error: ", stderr);
+  va_list ap;
+  va_start (ap, fmt);
+  vfprintf (stderr, fmt, ap);
+  va_end (ap);
+  fputc ('\n', stderr);
+  exit (1);
+}
+
+static void *
+allocate (size_t bytes)
+{
+  void *res = calloc (1, bytes ? bytes : 1);
+  if (!res)
+    die ("out-of-memory allocating %zu bytes", bytes);
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+push_literal (line * line, int lit)
+{
+  if (line->size == line->capacity)
+    {
+      line->capacity = line->capacity ? 2 * line->capacity : 16;
+      line->lits = realloc (line->lits, line->capacity * sizeof (int));
+      if (!line->lits)
+	die ("out-of-memory reallocating line");
+    }
+  line->lits[line->size++] = lit;
+}
+
+static int
+compare_literals (const void *p, const void *q)
+{
+  const int a = *(const int *) p, b = *(const int *) q;
+  const unsigned u = 2u * abs (a) + (a < 0), v = 2u * abs (b) + (b < 0);
+  return (u > v) - (u < v);
+}
+
+// Clauses are compared as sets of literals, thus they are sorted and
+// duplicated literals are removed before hashing.
+
+static void
+normalize_line (line * line)
+{
+  qsort (line->lits, line->size, sizeof (int), compare_literals);
+  size_t j = 0;
+  for (size_t i = 0; i < line->size; i++)
+    if (!j || line->lits[j - 1] != line->lits[i])
+      line->lits[j++] = line->lits[i];
+  line->size = j;
+}
+
+static uint64_t
+hash_line (const line * line)
+{
+  uint64_t res = line->size;
+  for (size_t i = 0; i < line->size; i++)
+    {
+      res += (unsigned) line->lits[i];
+      res *= 0x9e3779b97f4a7c15ull;
+      res ^= res >> 29;
+    }
+  return res ? res : 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+imported (uint64_t hash)
+{
+  if (!merge.size_imported)
+    return false;
+  const size_t mask = merge.size_imported - 1;
+  for (size_t pos = hash & mask; merge.imported[pos]; pos = (pos + 1) & mask)
+    if (merge.imported[pos] == hash)
+      return true;
+  return false;
+}
+
+static void
+insert_imported (uint64_t hash)
+{
+  if (2 * (merge.count_imported + 1) > merge.size_imported)
+    {
+      uint64_t *old = merge.imported;
+      const size_t old_size = merge.size_imported;
+      merge.size_imported = old_size ? 2 * old_size : 1024;
+      merge.imported = allocate (merge.size_imported * sizeof (uint64_t));
+      merge.count_imported = 0;
+      for (size_t i = 0; i < old_size; i++)
+	if (old[i])
+	  insert_imported (old[i]);
+      free (old);
+    }
+  const size_t mask = merge.size_imported - 1;
+  size_t pos = hash & mask;
+  while (merge.imported[pos])
+    {
+      if (merge.imported[pos] == hash)
+	return;
+      pos = (pos + 1) & mask;
+    }
+  merge.imported[pos] = hash;
+  merge.count_imported++;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+match_clause (const clause * c, const line * line)
+{
+  if (c->size != line->size)
+    return false;
+  const int *lits = merge.literals + c->offset;
+  return !memcmp (lits, line->lits, line->size * sizeof (int));
+}
+
+static void
+enlarge_table (void)
+{
+  clause *old = merge.table;
+  const size_t old_size = merge.size_table;
+  merge.size_table = old_size ? 2 * old_size : 1024;
+  merge.table = allocate (merge.size_table * sizeof (clause));
+  const size_t mask = merge.size_table - 1;
+  for (size_t i = 0; i < old_size; i++)
+    {
+      if (!old[i].hash)
+	continue;
+      size_t pos = old[i].hash & mask;
+      while (merge.table[pos].hash)
+	pos = (pos + 1) & mask;
+      merge.table[pos] = old[i];
+    }
+  free (old);
+}
+
+// Clauses are never removed from the table (only their count drops to
+// zero), which keeps linear probing simple.
+
+static clause *
+find_clause (const line * line, uint64_t hash, bool insert)
+{
+  if (insert && 2 * (merge.clauses + 1) > merge.size_table)
+    enlarge_table ();
+  if (!merge.size_table)
+    return 0;
+  const size_t mask = merge.size_table - 1;
+  size_t pos = hash & mask;
+  clause *c;
+  while ((c = merge.table + pos)->hash)
+    {
+      if (c->hash == hash && match_clause (c, line))
+	return c;
+      pos = (pos + 1) & mask;
+    }
+  if (!insert)
+    return 0;
+  while (merge.size_literals + line->size > merge.capacity_literals)
+    {
+      merge.capacity_literals =
+	merge.capacity_literals ? 2 * merge.capacity_literals : 1 << 16;
+      merge.literals = realloc (merge.literals,
+				merge.capacity_literals * sizeof (int));
+      if (!merge.literals)
+	die ("out-of-memory reallocating literals");
+    }
+  memcpy (merge.literals + merge.size_literals, line->lits,
+	  line->size * sizeof (int));
+  c->hash = hash;
+  c->offset = merge.size_literals;
+  c->size = line->size;
+  c->count = 0;
+  c->pinned = false;
+  merge.size_literals += line->size;
+  merge.clauses++;
+  return c;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+write_varint (unsigned x)
+{
+  while (x & ~0x7f)
+    {
+      putc ((x & 0x7f) | 0x80, merge.output);
+      x >>= 7;
+    }
+  putc (x, merge.output);
+}
+
+static void
+write_line (int type, const line * line)
+{
+  putc (type, merge.output);
+  for (size_t i = 0; i < line->size; i++)
+    {
+      const int lit = line->lits[i];
+      write_varint (2u * abs (lit) + (lit < 0));
+    }
+  putc (0, merge.output);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+parse_dimacs (const char *path)
+{
+  FILE *file = fopen (path, "r");
+  if (!file)
+    die ("can not read DIMACS file '%s'", path);
+  line line;
+  memset (&line, 0, sizeof line);
+  int ch;
+  while ((ch = getc (file)) == 'c' || ch == 'p')
+    while ((ch = getc (file)) != '\n')
+      if (ch == EOF)
+	break;
+  if (ch != EOF)
+    ungetc (ch, file);
+  int lit;
+  while (fscanf (file, "%d", &lit) == 1)
+    {
+      if (lit)
+	{
+	  push_literal (&line, lit);
+	  continue;
+	}
+      normalize_line (&line);
+      clause *c = find_clause (&line, hash_line (&line), true);
+      c->pinned = true;
+      c->count = 1;
+      merge.statistics.original++;
+      line.size = 0;
+    }
+  if (!feof (file))
+    die ("invalid DIMACS file '%s'", path);
+  if (line.size)
+    die ("unterminated clause in DIMACS file '%s'", path);
+  free (line.lits);
+  fclose (file);
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+read_varint (fragment * fragment, unsigned *res)
+{
+  unsigned x = 0, shift = 0;
+  int ch;
+  do
+    {
+      if ((ch = getc (fragment->file)) == EOF)
+	return false;
+      if (shift > 28)
+	die ("invalid varint in fragment '%s'", fragment->path);
+      x |= (unsigned) (ch & 0x7f) << shift;
+      shift += 7;
+    }
+  while (ch & 0x80);
+  *res = x;
+  return true;
+}
+
+// A truncated last line (of a killed solver) is treated as end-of-file.
+
+static bool
+read_line (fragment * fragment)
+{
+  line *line = &fragment->line;
+  line->size = 0;
+  const int type = getc (fragment->file);
+  if (type == EOF)
+    return false;
+  if (type != 'a' && type != 'd' && type != 'i')
+    die ("invalid line type 0x%02x in fragment '%s' (not binary?)",
+	 type, fragment->path);
+  line->type = type;
+  if (type == 'i' && !read_varint (fragment, &line->origin))
+    return false;
+  for (;;)
+    {
+      unsigned x;
+      if (!read_varint (fragment, &x))
+	return false;
+      if (!x)
+	break;
+      if (x < 2)
+	die ("invalid literal in fragment '%s'", fragment->path);
+      const int idx = x / 2;
+      push_literal (line, (x & 1) ? -idx : idx);
+    }
+  normalize_line (line);
+  fragment->lines++;
+  return true;
+}
+
+static void
+open_fragment (fragment * fragment)
+{
+  fragment->file = fopen (fragment->path, "rb");
+  if (!fragment->file)
+    die ("can not read fragment '%s'", fragment->path);
+  fragment->pending = fragment->finished = false;
+  fragment->lines = 0;
+}
+
+static void
+close_fragment (fragment * fragment)
+{
+  if (fragment->file)
+    fclose (fragment->file);
+  fragment->file = 0;
+  fragment->finished = true;
+}
+
+static void
+collect_imported (fragment * fragment)
+{
+  open_fragment (fragment);
+  while (read_line (fragment))
+    if (fragment->line.type == 'i')
+      insert_imported (hash_line (&fragment->line));
+  close_fragment (fragment);
+}
+
+/*------------------------------------------------------------------------*/
+
+// Returns 'false' if the line is an import of a clause not added yet.
+
+static bool
+merge_line (const line * line, bool *empty)
+{
+  const uint64_t hash = hash_line (line);
+  if (line->type == 'd')
+    {
+      clause *c = find_clause (line, hash, false);
+      if (!c || !c->count)
+	{
+	  merge.statistics.skipped++;
+	  return true;
+	}
+      if (c->pinned)
+	{
+	  if (c->count > 1)
+	    c->count--;
+	  return true;
+	}
+      if (!--c->count)
+	{
+	  write_line ('d', line);
+	  merge.statistics.deleted++;
+	}
+      return true;
+    }
+  clause *c = find_clause (line, hash, line->type == 'a');
+  if (line->type == 'i')
+    {
+      if (!c || !c->count)
+	return false;
+      merge.statistics.imported++;
+    }
+  else if (!c->count)
+    {
+      write_line ('a', line);
+      merge.statistics.added++;
+      if (!line->size)
+	*empty = true;
+      if (imported (hash))
+	c->pinned = true;
+    }
+  c->count++;
+  return true;
+}
+
+static bool
+merge_fragment (fragment * fragment, bool *empty)
+{
+  bool progress = false;
+  while (!*empty)
+    {
+      if (!fragment->pending)
+	{
+	  if (!read_line (fragment))
+	    {
+	      close_fragment (fragment);
+	      return true;
+	    }
+	  fragment->pending = true;
+	}
+      if (!merge_line (&fragment->line, empty))
+	break;
+      fragment->pending = false;
+      progress = true;
+    }
+  return progress;
+}
+
+static bool
+merge_fragments (size_t size, fragment * fragments)
+{
+  for (size_t i = 0; i < size; i++)
+    open_fragment (fragments + i);
+  bool empty = false;
+  for (;;)
+    {
+      bool progress = false, remaining = false;
+      for (size_t i = 0; !empty && i < size; i++)
+	{
+	  fragment *fragment = fragments + i;
+	  if (fragment->finished)
+	    continue;
+	  if (merge_fragment (fragment, &empty))
+	    progress = true;
+	  remaining |= !fragment->finished;
+	}
+      if (empty || !remaining)
+	break;
+      if (progress)
+	continue;
+      for (size_t i = 0; i < size; i++)
+	if (!fragments[i].finished)
+	  fprintf (stderr, "ssat-merge: fragment '%s' line %" PRIu64
+		   " imports from fragment %u a clause never added\n",
+		   fragments[i].path, fragments[i].lines,
+		   fragments[i].line.origin);
+      die ("fragments can not be merged");
+    }
+  for (size_t i = 0; i < size; i++)
+    close_fragment (fragments + i);
+  return empty;
+}
+
+/*------------------------------------------------------------------------*/
+
+int
+main (int argc, char **argv)
+{
+  if (argc < 3)
+    {
+      fprintf (stderr,
+	       "usage: ssat-merge <dimacs> <fragment> ... > <proof>\n");
+      return 1;
+    }
+  merge.output = stdout;
+  const size_t size = argc - 2;
+  fragment *fragments = allocate (size * sizeof *fragments);
+  for (size_t i = 0; i < size; i++)
+    fragments[i].path = argv[i + 2];
+  for (size_t i = 0; i < size; i++)
+    collect_imported (fragments + i);
+  parse_dimacs (argv[1]);
+  const bool empty = merge_fragments (size, fragments);
+  if (fflush (merge.output))
+    die ("failed to write proof");
+  fprintf (stderr, "ssat-merge: %" PRIu64 " original %" PRIu64
+	   " added %" PRIu64 " deleted %" PRIu64 " imported clauses (%"
+	   PRIu64 " deletions skipped)\n", merge.statistics.original,
+	   merge.statistics.added, merge.statistics.deleted,
+	   merge.statistics.imported, merge.statistics.skipped);
+  for (size_t i = 0; i < size; i++)
+    free (fragments[i].line.lits);
+  free (fragments);
+  free (merge.table);
+  free (merge.literals);
+  free (merge.imported);
+  if (!empty)
+    die ("no fragment derived the empty clause");
+  return 0;
+}
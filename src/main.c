@@ -1,4 +1,16 @@
 
+#include "file_utils/checkpoint.h"
+#include "file_utils/fragment.h"
+#include "parallel/cube.h"
+#include "parallel/portfolio.h"
+#include "parallel/share.h"
+#include "parallel/threads.h"
+#include "parallel/vivifier.h"
+#include "parallel/walkers.h"
+#include "parallel/window.h"
+#include "counters.h"
+#include "ternary.h"
+
 struct ssat *volatile solver;
 
 // The main CDCL loop in kissat, we wish to change the solver inner data structure so it can solve large problem, and communicate easily when runnning in parallel
@@ -6,10 +18,12 @@ static int
 CDCL (ssat * solver)
 {
   start_search (solver);
+  kissat_resume_search (solver); // after '--resume'
   int res = solver->inconsistent ? 20 : 0;
   while (!res)
     {
       clause *conflict = search_propagate (solver);
+      kissat_poll_portfolio (solver); // other ranks might have finished
       if (conflict)
 	res = sat_analyze (solver, conflict);
       else if (solver->iterating)
@@ -25,7 +39,7 @@ CDCL (ssat * solver)
       else if (sat_switching_search_mode (solver))
 	sat_switch_search_mode (solver);
       else if (sat_restarting (solver))
-	sat_restart (solver);
+	res = sat_restart (solver);
       else if (sat_rephasing (solver))
 	sat_rephase (solver);
       else if (sat_eliminating (solver))
@@ -34,6 +48,8 @@ CDCL (ssat * solver)
 	res = sat_probe (solver);
       else if (decision_limit_hit (solver))
 	break;
+      else if (kissat_cubing (solver))
+	kissat_decide_cube (solver);
       else
 	sat_decide (solver);
     }
@@ -68,11 +84,13 @@ sat_solve (ssat * solver,
   if (!write_proof (&application))
     return 1;
 #endif
+  kissat_open_fragment (solver, 0); // '--fragments=<path>'
   if (!parse_input (&application))
     {
 #ifndef NPROOFS
       close_proof (&application);
 #endif
+      kissat_close_fragment (solver, 0);
       return 1;
     }
 #ifndef QUIET
@@ -82,8 +100,30 @@ sat_solve (ssat * solver,
   print_limits (&application);
   kissat_section (solver, "solving");
 #endif
-  int res = kissat_solve (solver);
-  if (res)
+  kissat_resume_checkpoint (solver);
+  kissat_init_counters (solver);
+  kissat_init_ternary (solver);
+  kissat_init_share (solver);
+  kissat_init_window (solver);
+  kissat_init_vivifier (solver);
+  kissat_init_walkers (solver);
+  kissat *model = solver; // the instance which found the result
+  int res;
+  if (kissat_portfolio_cubing ())
+    res = kissat_solve_cubes (solver);
+  else if (kissat_threads () > 1)
+    res = kissat_solve_threads (solver, &model);
+  else
+    res = kissat_solve (solver);
+  bool print; // only the winning rank prints the result
+  res = kissat_finish_portfolio (solver, res, &print);
+  kissat_release_walkers (solver);
+  kissat_release_vivifier (solver);
+  kissat_release_window (solver);
+  kissat_release_share (solver);
+  kissat_release_ternary (solver);
+  kissat_release_counters (solver);
+  if (res && print)
     {
       kissat_section (solver, "result");
       if (res == 20)
@@ -95,21 +135,23 @@ sat_solve (ssat * solver,
 	{
 #ifndef NDEBUG
 	  if (GET_OPTION (check))
-	    kissat_check_satisfying_assignment (solver);
+	    kissat_check_satisfying_assignment (model);
 #endif
 	  printf ("s SATISFIABLE\n");
 	  fflush (stdout);
 	  if (application.witness)
-	    kissat_print_witness (solver,
+	    kissat_print_witness (model,
 				  application.max_var, application.partial);
 	}
     }
+  kissat_release_threads (solver);
 #ifndef QUIET
   kissat_print_statistics (solver);
 #endif
 #ifndef NPROOFS
   close_proof (&application);
 #endif
+  kissat_close_fragment (solver, 0);
 #ifndef QUIET
   kissat_section (solver, "shutting down");
   kissat_message (solver, "exit %d", res);
@@ -120,16 +162,22 @@ sat_solve (ssat * solver,
 int
 main (int argc, char **argv)
 {
+  kissat_init_portfolio (&argc, &argv); // '--portfolio' starts MPI
+  kissat_init_threads (&argc, &argv); // '-t N' solves with 'N' threads
+  kissat_init_checkpoint (&argc, &argv); // '--checkpoint=<file>' etc.
+  kissat_init_fragments (&argc, &argv); // '--fragments=<path>'
   solver = solver_init();
   // solver options are set in config file.
   if (!solver)
     error ("failed to initialize solver");    
   kissat_init_alarm (kissat_alarm_handler);      
   kissat_init_signal_handler (kissat_signal_handler);
+  kissat_configure_portfolio (solver); // diversify options per rank
   banner (); // print solver info
   int res = sat_solve (solver);
   reset_signal_handler ();
   sat_release (solver);
+  kissat_release_portfolio ();
 #ifndef NDEBUG
   if (!res)
     return dump (0);
@@ -0,0 +1,323 @@
+// Benchmark of the per-variable 'assigned' records (see 'assign.h') before
+// and after moving the conflict analysis flags into the separate 'analysis'
+// array.  The 'combined' layout has all flags in one 16 byte record, the
+// 'split' layout has a 12 byte hot record for propagation and a 1 byte
+// cold record of analysis flags.  Two kernels run on both layouts over the
+// given number of variables in random trail order.  The 'propagate' kernel
+// assigns variables in trail order as 'kissat_fast_assign' does, after
+// reading the levels of two other literals of the reason as computed by
+// 'kissat_assignment_level'.  The 'analyze' kernel marks some variables as
+// analyzed and walks the trail backwards from random positions as in
+// 'kissat_deduce_first_uip_clause', testing the analyzed flag of every
+// variable and reading level and reason only of analyzed ones.  It reports
+// time and (if 'perf_event_open' is available) last level cache misses
+// per visited variable.  Standalone, build and run with
+//
+//   cc -O2 -o assigned src/measures/assigned.c
+//   ./assigned [ <variables> [ <walks> [ <analyzed> ] ] ]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define DEPTH 1000
+
+typedef struct combined combined;
+typedef struct hot hot;
+typedef struct cold cold;
+
+struct combined
+{
+  unsigned level;
+  unsigned trail;
+  bool analyzed:1;
+  bool binary:1;
+  bool poisoned:1;
+  bool redundant:1;
+  bool removable:1;
+  bool shrinkable:1;
+  unsigned reason;
+};
+
+struct hot
+{
+  unsigned level;
+  unsigned trail:29;
+  bool binary:1;
+  bool redundant:1;
+  unsigned reason;
+};
+
+struct cold
+{
+  bool analyzed:1;
+  bool poisoned:1;
+  bool removable:1;
+  bool shrinkable:1;
+};
+
+static uint64_t state = 42;
+
+static unsigned
+pick (unsigned low, unsigned high)
+{
+  state = 6364136223846793005ul * state + 1442695040888963407ul;
+  return low + (unsigned) ((state >> 32) % (high - low));
+}
+
+static double
+seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static int
+open_misses (void)
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof attr;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static void
+start_misses (int fd)
+{
+#ifdef __linux__
+  if (fd < 0)
+    return;
+  ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+#else
+  (void) fd;
+#endif
+}
+
+static uint64_t
+stop_misses (int fd)
+{
+  uint64_t res = 0;
+#ifdef __linux__
+  if (fd < 0)
+    return 0;
+  ioctl (fd, PERF_EVENT_IOC_DISABLE, 0);
+  if (read (fd, &res, sizeof res) != sizeof res)
+    res = 0;
+#else
+  (void) fd;
+#endif
+  return res;
+}
+
+// Reasons are given as two random other variables per trail position,
+// the level increases every 'DEPTH' / 10 trail positions.
+
+static uint64_t
+propagate_combined (combined * all, const unsigned *trail,
+		    const unsigned *reasons, unsigned vars)
+{
+  uint64_t res = 0;
+  for (unsigned i = 0; i < vars; i++)
+    {
+      const unsigned *const r = reasons + 2 * i;
+      unsigned level = all[r[0]].level;
+      if (level < all[r[1]].level)
+	level = all[r[1]].level;
+      res += level;
+      combined b;
+      b.level = i / (DEPTH / 10);
+      b.trail = i;
+      b.analyzed = false;
+      b.binary = (i & 1);
+      b.poisoned = false;
+      b.reason = r[0];
+      b.redundant = false;
+      b.removable = false;
+      b.shrinkable = false;
+      all[trail[i]] = b;
+    }
+  return res;
+}
+
+static uint64_t
+propagate_split (hot * all, const unsigned *trail,
+		 const unsigned *reasons, unsigned vars)
+{
+  uint64_t res = 0;
+  for (unsigned i = 0; i < vars; i++)
+    {
+      const unsigned *const r = reasons + 2 * i;
+      unsigned level = all[r[0]].level;
+      if (level < all[r[1]].level)
+	level = all[r[1]].level;
+      res += level;
+      hot b;
+      b.level = i / (DEPTH / 10);
+      b.trail = i;
+      b.binary = (i & 1);
+      b.reason = r[0];
+      b.redundant = false;
+      all[trail[i]] = b;
+    }
+  return res;
+}
+
+static uint64_t
+analyze_combined (combined * all, const unsigned *trail,
+		  const unsigned *starts, unsigned walks)
+{
+  uint64_t res = 0;
+  for (unsigned i = 0; i < walks; i++)
+    for (const unsigned *t = trail + starts[i], *end = t - DEPTH; t != end;)
+      {
+	const combined *const a = all + *--t;
+	if (!a->analyzed)
+	  continue;
+	res += a->level + a->reason;
+      }
+  return res;
+}
+
+static uint64_t
+analyze_split (const hot * all, const cold * flags, const unsigned *trail,
+	       const unsigned *starts, unsigned walks)
+{
+  uint64_t res = 0;
+  for (unsigned i = 0; i < walks; i++)
+    for (const unsigned *t = trail + starts[i], *end = t - DEPTH; t != end;)
+      {
+	const unsigned idx = *--t;
+	if (!flags[idx].analyzed)
+	  continue;
+	const hot *const a = all + idx;
+	res += a->level + a->reason;
+      }
+  return res;
+}
+
+static void
+report (const char *name, const char *layout, double time,
+	uint64_t misses, int fd, double visited, double base)
+{
+  printf ("%-9s %-8s %6.2f ns/variable speed-up %.2f", name, layout,
+	  1e9 * time / visited, base / time);
+  if (fd >= 0)
+    printf (" %.3f misses/variable", misses / visited);
+  fputc ('\n', stdout);
+}
+
+int
+main (int argc, char **argv)
+{
+  const unsigned vars = argc > 1 ? atoi (argv[1]) : 10000000;
+  const unsigned walks = argc > 2 ? atoi (argv[2]) : 100000;
+  const unsigned percent = argc > 3 ? atoi (argv[3]) : 2;
+  if (vars <= DEPTH || !walks || percent > 100)
+    {
+      fprintf (stderr,
+	       "usage: assigned [ <variables> [ <walks> [ <analyzed> ] ] ]\n");
+      return 1;
+    }
+  combined *combined = calloc (vars, sizeof *combined);
+  hot *hot = calloc (vars, sizeof *hot);
+  cold *cold = calloc (vars, sizeof *cold);
+  unsigned *trail = malloc (vars * sizeof *trail);
+  unsigned *reasons = malloc (2 * (size_t) vars * sizeof *reasons);
+  unsigned *starts = malloc (walks * sizeof *starts);
+  if (!combined || !hot || !cold || !trail || !reasons || !starts)
+    {
+      fprintf (stderr, "assigned: out of memory\n");
+      return 1;
+    }
+  for (unsigned i = 0; i < vars; i++)
+    trail[i] = i;
+  for (unsigned i = vars - 1; i; i--)
+    {
+      const unsigned j = pick (0, i + 1), tmp = trail[i];
+      trail[i] = trail[j], trail[j] = tmp;
+    }
+  for (size_t i = 0; i < 2 * (size_t) vars; i++)
+    reasons[i] = pick (0, vars);
+  for (unsigned i = 0; i < walks; i++)
+    starts[i] = pick (DEPTH, vars + 1);
+  printf ("%u variables (%zu + %zu bytes split, %zu bytes combined), "
+	  "%u walks of %u, %u%% analyzed\n", vars, sizeof *hot,
+	  sizeof *cold, sizeof *combined, walks, DEPTH, percent);
+  const int fd = open_misses ();
+  if (fd < 0)
+    printf ("cache misses not available (perf_event_open failed)\n");
+
+  start_misses (fd);
+  double start = seconds ();
+  const uint64_t propagated_combined =
+    propagate_combined (combined, trail, reasons, vars);
+  double time = seconds () - start;
+  uint64_t misses = stop_misses (fd);
+  const double base_propagate = time;
+  report ("propagate", "combined", time, misses, fd, vars, time);
+
+  start_misses (fd);
+  start = seconds ();
+  const uint64_t propagated_split =
+    propagate_split (hot, trail, reasons, vars);
+  time = seconds () - start;
+  misses = stop_misses (fd);
+  report ("propagate", "split", time, misses, fd, vars, base_propagate);
+
+  for (unsigned idx = 0; idx < vars; idx++)
+    if (pick (0, 100) < percent)
+      combined[idx].analyzed = cold[idx].analyzed = true;
+
+  const double visited = (double) walks * DEPTH;
+  start_misses (fd);
+  start = seconds ();
+  const uint64_t analyzed_combined =
+    analyze_combined (combined, trail, starts, walks);
+  time = seconds () - start;
+  misses = stop_misses (fd);
+  const double base_analyze = time;
+  report ("analyze", "combined", time, misses, fd, visited, time);
+
+  start_misses (fd);
+  start = seconds ();
+  const uint64_t analyzed_split =
+    analyze_split (hot, cold, trail, starts, walks);
+  time = seconds () - start;
+  misses = stop_misses (fd);
+  report ("analyze", "split", time, misses, fd, visited, base_analyze);
+
+  free (starts);
+  free (reasons);
+  free (trail);
+  free (cold);
+  free (hot);
+  free (combined);
+  if (propagated_combined != propagated_split ||
+      analyzed_combined != analyzed_split)
+    {
+      fprintf (stderr, "assigned: checksum mismatch\n");
+      return 1;
+    }
+  return 0;
+}
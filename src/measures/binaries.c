@@ -0,0 +1,278 @@
+// Benchmark of binary watch insertion and propagation (see
+// 'kissat_push_binary_watch' in 'inline.h') with and without the
+// per-literal count of binary watches.  Watch lists are modelled as in the
+// solver, with one word per binary watch in front of two words per large
+// watch and the binary flag in the least significant bit.  The 'learn'
+// kernel inserts binary watches into random lists, either by moving the
+// large watches up one word at a time until a binary watch is found
+// ('scan') or by one block move behind the counted binary watches
+// ('count').  The 'propagate' kernel visits the binary watches of random
+// lists, either testing the flag of each watch to find the first large
+// watch ('scan') or stopping at the counted end ('count').  Both kernels
+// report nanoseconds per operation.  Standalone, build and run with
+//
+//   cc -O2 -o binaries src/measures/binaries.c
+//   ./binaries [ <lists> [ <binaries> [ <large> [ <operations> ] ] ] ]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct list list;
+
+struct list
+{
+  uint32_t *begin;
+  unsigned size, capacity;
+  unsigned binaries;
+};
+
+static uint64_t state = 42;
+
+static unsigned
+pick (unsigned low, unsigned high)
+{
+  state = 6364136223846793005ul * state + 1442695040888963407ul;
+  return low + (unsigned) ((state >> 32) % (high - low));
+}
+
+static double
+seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void
+push (list * l, uint32_t word)
+{
+  if (l->size == l->capacity)
+    {
+      l->capacity = l->capacity ? 2 * l->capacity : 4;
+      l->begin = realloc (l->begin, l->capacity * sizeof *l->begin);
+      if (!l->begin)
+	{
+	  fprintf (stderr, "binaries: out of memory\n");
+	  exit (1);
+	}
+    }
+  l->begin[l->size++] = word;
+}
+
+static uint32_t
+binary_watch (unsigned other)
+{
+  return 2 * other + 1;
+}
+
+// Same random lists for both variants, with on average the given number
+// of binary and large watches per list.
+
+static list *
+generate (unsigned lists, unsigned binaries, unsigned large)
+{
+  list *res = calloc (lists, sizeof *res);
+  if (!res)
+    {
+      fprintf (stderr, "binaries: out of memory\n");
+      exit (1);
+    }
+  state = 42;
+  for (unsigned i = 0; i < lists; i++)
+    {
+      list *const l = res + i;
+      const unsigned b = pick (0, 2 * binaries + 1);
+      const unsigned g = pick (0, 2 * large + 1);
+      for (unsigned j = 0; j < b; j++)
+	push (l, binary_watch (pick (0, lists)));
+      for (unsigned j = 0; j < g; j++)
+	{
+	  push (l, 2 * pick (0, lists));
+	  push (l, 2 * j);
+	}
+      l->binaries = b;
+    }
+  return res;
+}
+
+static void
+release (list * all, unsigned lists)
+{
+  for (unsigned i = 0; i < lists; i++)
+    free (all[i].begin);
+  free (all);
+}
+
+static void
+learn_scan (list * all, const unsigned *targets, unsigned operations)
+{
+  for (unsigned i = 0; i < operations; i++)
+    {
+      list *const l = all + targets[2 * i];
+      const uint32_t watch = binary_watch (targets[2 * i + 1]);
+      push (l, watch);
+      uint32_t *const begin = l->begin;
+      uint32_t *p = begin + l->size - 1;
+      while (p != begin && !(p[-1] & 1))
+	{
+	  *p = p[-1];
+	  p--;
+	}
+      *p = watch;
+    }
+}
+
+static void
+learn_count (list * all, const unsigned *targets, unsigned operations)
+{
+  for (unsigned i = 0; i < operations; i++)
+    {
+      list *const l = all + targets[2 * i];
+      const uint32_t watch = binary_watch (targets[2 * i + 1]);
+      push (l, watch);
+      uint32_t *const first_large = l->begin + l->binaries;
+      uint32_t *const last = l->begin + l->size - 1;
+      if (first_large != last)
+	{
+	  memmove (first_large + 1, first_large,
+		   (last - first_large) * sizeof *first_large);
+	  *first_large = watch;
+	}
+      l->binaries++;
+    }
+}
+
+static uint64_t
+propagate_scan (const list * all, const unsigned *targets,
+		unsigned operations)
+{
+  uint64_t res = 0;
+  for (unsigned i = 0; i < operations; i++)
+    {
+      const list *const l = all + targets[2 * i];
+      const uint32_t *p = l->begin;
+      const uint32_t *const end = p + l->size;
+      while (p != end && (*p & 1))
+	res += *p++ >> 1;
+      if (p != end)
+	res += p[1];
+    }
+  return res;
+}
+
+static uint64_t
+propagate_count (const list * all, const unsigned *targets,
+		 unsigned operations)
+{
+  uint64_t res = 0;
+  for (unsigned i = 0; i < operations; i++)
+    {
+      const list *const l = all + targets[2 * i];
+      const uint32_t *p = l->begin;
+      const uint32_t *const end = p + l->size;
+      const uint32_t *const end_binaries = p + l->binaries;
+      while (p != end_binaries)
+	res += *p++ >> 1;
+      if (p != end)
+	res += p[1];
+    }
+  return res;
+}
+
+static void
+check (const list * a, const list * b, unsigned lists)
+{
+  for (unsigned i = 0; i < lists; i++)
+    {
+      const list *const l = a + i, *const k = b + i;
+      bool same = (l->size == k->size);
+      for (unsigned j = 0; same && j < l->binaries; j++)
+	same = (l->begin[j] & 1) && (k->begin[j] & 1);
+      for (unsigned j = l->binaries; same && j < l->size; j++)
+	same = (l->begin[j] == k->begin[j]);
+      if (!same)
+	{
+	  fprintf (stderr, "binaries: lists %u differ\n", i);
+	  exit (1);
+	}
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  const unsigned lists = argc > 1 ? (unsigned) atoi (argv[1]) : 1u << 18;
+  const unsigned binaries = argc > 2 ? (unsigned) atoi (argv[2]) : 4;
+  const unsigned large = argc > 3 ? (unsigned) atoi (argv[3]) : 32;
+  const unsigned operations =
+    argc > 4 ? (unsigned) atoi (argv[4]) : 1u << 22;
+  if (lists < 2 || !operations)
+    {
+      fprintf (stderr, "binaries: invalid arguments\n");
+      return 1;
+    }
+
+  unsigned *targets = malloc (2 * (size_t) operations * sizeof *targets);
+  if (!targets)
+    {
+      fprintf (stderr, "binaries: out of memory\n");
+      return 1;
+    }
+  for (unsigned i = 0; i < 2 * operations; i++)
+    targets[i] = pick (0, lists);
+
+  list *scanned = generate (lists, binaries, large);
+  list *counted = generate (lists, binaries, large);
+
+  // Both variants run once untimed, so that neither of them profits from
+  // 'targets' being brought into the cache by the other.
+
+  uint64_t sum_scan = propagate_scan (scanned, targets, operations);
+  uint64_t sum_count = propagate_count (counted, targets, operations);
+
+  double start = seconds ();
+  sum_scan += propagate_scan (scanned, targets, operations);
+  const double propagate_scan_time = seconds () - start;
+  start = seconds ();
+  sum_count += propagate_count (counted, targets, operations);
+  const double propagate_count_time = seconds () - start;
+  if (sum_scan != sum_count)
+    {
+      fprintf (stderr, "binaries: propagation sums differ\n");
+      return 1;
+    }
+
+  const unsigned learned = operations / 16;
+  start = seconds ();
+  learn_scan (scanned, targets, learned);
+  const double learn_scan_time = seconds () - start;
+  for (unsigned i = 0; i < lists; i++)
+    scanned[i].binaries = counted[i].binaries;
+  start = seconds ();
+  learn_count (counted, targets, learned);
+  const double learn_count_time = seconds () - start;
+  for (unsigned i = 0; i < learned; i++)
+    scanned[targets[2 * i]].binaries++;
+  check (scanned, counted, lists);
+
+  const double ns = 1e9;
+  printf ("%u lists with %u binary and %u large watches on average\n",
+	  lists, binaries, large);
+  printf ("propagate scan  %6.2f ns per list\n",
+	  ns * propagate_scan_time / operations);
+  printf ("propagate count %6.2f ns per list\n",
+	  ns * propagate_count_time / operations);
+  printf ("learn scan      %6.2f ns per binary watch\n",
+	  ns * learn_scan_time / learned);
+  printf ("learn count     %6.2f ns per binary watch\n",
+	  ns * learn_count_time / learned);
+
+  release (scanned, lists);
+  release (counted, lists);
+  free (targets);
+  return 0;
+}
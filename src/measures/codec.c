@@ -0,0 +1,134 @@
+// Benchmark of the clause batch wire format in 'parallel/codec.c'.  It
+// generates batches of random clauses as exported by 'parallel/share.c'
+// (glue, sorted external literals, zero sentinel), encodes and decodes them
+// repeatedly and reports the compression ratio over sending raw 'int'
+// literals as well as encoding and decoding throughput.  Standalone, build
+// and run with
+//
+//   cc -O2 -o codec -I src/parallel src/measures/codec.c src/parallel/codec.c
+//   ./codec [ <variables> [ <clauses> [ <rounds> ] ] ]
+
+#include "codec.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t state = 42;
+
+static unsigned
+pick (unsigned low, unsigned high)
+{
+  state = 6364136223846793005ul * state + 1442695040888963407ul;
+  return low + (unsigned) ((state >> 32) % (high - low));
+}
+
+static double
+seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static unsigned
+key (int elit)
+{
+  return 2u * (unsigned) abs (elit) + (elit < 0);
+}
+
+static int
+cmp (const void *p, const void *q)
+{
+  const unsigned a = key (*(const int *) p), b = key (*(const int *) q);
+  return (a > b) - (a < b);
+}
+
+// Learned clauses are short and their variables are clustered, which we
+// mimic by drawing the literals of a clause close to a random center.
+
+static size_t
+generate (unsigned vars, unsigned clauses, int *batch)
+{
+  int *p = batch;
+  for (unsigned i = 0; i < clauses; i++)
+    {
+      const unsigned size = pick (2, 9);
+      const unsigned glue = pick (1, size + 1);
+      const unsigned spread = vars < 1000 ? vars : 1000;
+      const unsigned center = pick (1, vars + 1);
+      *p++ = glue;
+      int *lits = p;
+      while ((unsigned) (p - lits) < size)
+	{
+	  int idx = center + pick (0, spread) - spread / 2;
+	  if (idx < 1)
+	    idx += vars;
+	  if (idx > (int) vars)
+	    idx -= vars;
+	  bool duplicated = false;
+	  for (int *q = lits; !duplicated && q != p; q++)
+	    duplicated = (abs (*q) == idx);
+	  if (!duplicated)
+	    *p++ = pick (0, 2) ? -idx : idx;
+	}
+      qsort (lits, size, sizeof *lits, cmp);
+      *p++ = 0;
+    }
+  return p - batch;
+}
+
+int
+main (int argc, char **argv)
+{
+  const unsigned vars = argc > 1 ? atoi (argv[1]) : 1000000;
+  const unsigned clauses = argc > 2 ? atoi (argv[2]) : 1000;
+  const unsigned rounds = argc > 3 ? atoi (argv[3]) : 1000;
+  if (!vars || !clauses || !rounds)
+    {
+      fprintf (stderr, "usage: codec [ <vars> [ <clauses> [ <rounds> ] ] ]\n");
+      return 1;
+    }
+  int *batch = malloc (10 * (size_t) clauses * sizeof *batch);
+  const size_t size = generate (vars, clauses, batch);
+  unsigned char *bytes = malloc (kissat_encoded_batch_bound (size));
+  int *decoded = malloc (kissat_encoded_batch_bound (size) * sizeof (int));
+  if (!batch || !bytes || !decoded)
+    {
+      fprintf (stderr, "codec: out of memory\n");
+      return 1;
+    }
+  size_t encoded = 0;
+  double start = seconds ();
+  for (unsigned r = 0; r < rounds; r++)
+    encoded = kissat_encode_batch (r % 64, size, batch, bytes);
+  const double encoding = seconds () - start;
+  int origin = -1;
+  size_t count = 0;
+  bool ok = true;
+  start = seconds ();
+  for (unsigned r = 0; ok && r < rounds; r++)
+    ok = kissat_decode_batch (encoded, bytes, &origin, &count, decoded);
+  const double decoding = seconds () - start;
+  if (!ok || origin != (int) ((rounds - 1) % 64) || count != size ||
+      memcmp (batch, decoded, size * sizeof *batch))
+    {
+      fprintf (stderr, "codec: round trip failed\n");
+      return 1;
+    }
+  const double raw = size * sizeof (int);
+  const double mb = (double) rounds * raw / (1 << 20);
+  printf ("%u clauses over %u variables in %zu integers\n",
+	  clauses, vars, size);
+  printf ("raw %.0f bytes, encoded %zu bytes, ratio %.2f\n",
+	  raw, encoded, raw / encoded);
+  printf ("encoding %.0f MB/s, decoding %.0f MB/s (of raw batches)\n",
+	  mb / encoding, mb / decoding);
+  free (decoded);
+  free (bytes);
+  free (batch);
+  return 0;
+}
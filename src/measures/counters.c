@@ -0,0 +1,368 @@
+// Benchmark of counter-based propagation (see 'counters.h') against the
+// usual two watched literals with blocking literals.  It generates random
+// formulas with the given number of variables for clause lengths 3, 4, 5
+// and 7 and several ratios of clauses to variables, i.e., for different
+// numbers of occurrences per literal.  Both engines then propagate the same
+// sequence of random decisions, backtrack to the root-level on conflicts
+// and after every 'depth' decisions.  Since unit propagation either fails
+// or reaches the same fix-point for both engines, they have to end up with
+// the same number of conflicts and assignments, which is checked.  Ratios
+// are scaled by 2^(length-3) to keep formulas equally constrained.  Time is
+// reported per propagated literal.  Standalone, build and run with
+//
+//   cc -O2 -o counters src/measures/counters.c
+//   ./counters [ <variables> [ <decisions> [ <depth> ] ] ]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NOT(LIT) ((LIT) ^ 1u)
+#define IDX(LIT) ((LIT) >> 1)
+
+typedef struct counter counter;
+typedef struct formula formula;
+typedef struct list list;
+typedef struct solver solver;
+
+struct list
+{
+  unsigned size, capacity;
+  unsigned *data;
+};
+
+struct counter
+{
+  unsigned count;
+  unsigned sum;
+};
+
+struct formula
+{
+  unsigned vars, clauses, length;
+  unsigned *lits;
+};
+
+struct solver
+{
+  const formula *formula;
+  signed char *values;
+  unsigned *trail, size, propagate;
+  list *lists;
+  counter *counters;
+};
+
+static uint64_t state = 42;
+
+static unsigned
+pick (unsigned low, unsigned high)
+{
+  state = 6364136223846793005ul * state + 1442695040888963407ul;
+  return low + (unsigned) ((state >> 32) % (high - low));
+}
+
+static double
+seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void
+push (list * l, unsigned x)
+{
+  if (l->size == l->capacity)
+    {
+      l->capacity = l->capacity ? 2 * l->capacity : 4;
+      l->data = realloc (l->data, l->capacity * sizeof *l->data);
+      if (!l->data)
+	{
+	  fprintf (stderr, "counters: out of memory\n");
+	  exit (1);
+	}
+    }
+  l->data[l->size++] = x;
+}
+
+// Clauses have 'length' different variables with random signs.
+
+static void
+generate (formula * f, unsigned vars, unsigned clauses, unsigned length)
+{
+  f->vars = vars, f->clauses = clauses, f->length = length;
+  f->lits = malloc ((size_t) clauses * length * sizeof *f->lits);
+  for (unsigned i = 0; i < clauses; i++)
+    {
+      unsigned *const c = f->lits + (size_t) i * length;
+      for (unsigned j = 0; j < length; j++)
+	{
+	  unsigned idx, k;
+	  do
+	    {
+	      idx = pick (0, vars);
+	      for (k = 0; k < j && IDX (c[k]) != idx; k++)
+		;
+	    }
+	  while (k < j);
+	  c[j] = 2 * idx + pick (0, 2);
+	}
+    }
+}
+
+static void
+init (solver * s, const formula * f, int counting)
+{
+  const unsigned lits = 2 * f->vars;
+  s->formula = f;
+  s->values = calloc (lits, 1);
+  s->trail = malloc (f->vars * sizeof *s->trail);
+  s->size = s->propagate = 0;
+  s->lists = calloc (lits, sizeof *s->lists);
+  s->counters = 0;
+  const unsigned length = f->length;
+  if (counting)
+    {
+      s->counters = malloc (f->clauses * sizeof *s->counters);
+      for (unsigned i = 0; i < f->clauses; i++)
+	{
+	  const unsigned *const c = f->lits + (size_t) i * length;
+	  s->counters[i].count = length;
+	  s->counters[i].sum = 0;
+	  for (unsigned j = 0; j < length; j++)
+	    {
+	      s->counters[i].sum += c[j];
+	      push (s->lists + c[j], i);
+	    }
+	}
+    }
+  else
+    for (unsigned i = 0; i < f->clauses; i++)
+      {
+	const unsigned *const c = f->lits + (size_t) i * length;
+	push (s->lists + c[0], c[1]), push (s->lists + c[0], i);
+	push (s->lists + c[1], c[0]), push (s->lists + c[1], i);
+      }
+}
+
+static void
+release (solver * s)
+{
+  for (unsigned lit = 0; lit < 2 * s->formula->vars; lit++)
+    free (s->lists[lit].data);
+  free (s->lists);
+  free (s->counters);
+  free (s->trail);
+  free (s->values);
+}
+
+static void
+assign (solver * s, unsigned lit)
+{
+  s->values[lit] = 1;
+  s->values[NOT (lit)] = -1;
+  s->trail[s->size++] = lit;
+}
+
+// Watch lists hold pairs of blocking literal and clause index.  The
+// watched literals of a clause are its first two literals.
+
+static int
+propagate_watches (solver * s)
+{
+  const unsigned length = s->formula->length;
+  unsigned *const all = s->formula->lits;
+  signed char *const values = s->values;
+  while (s->propagate < s->size)
+    {
+      const unsigned not_lit = NOT (s->trail[s->propagate++]);
+      list *const watches = s->lists + not_lit;
+      unsigned *q = watches->data, *p = q;
+      const unsigned *const end = q + watches->size;
+      int conflict = 0;
+      while (!conflict && p != end)
+	{
+	  const unsigned blocking = *q++ = *p++;
+	  const unsigned idx = *q++ = *p++;
+	  if (values[blocking] > 0)
+	    continue;
+	  unsigned *const c = all + (size_t) idx * length;
+	  const unsigned other = c[0] ^ c[1] ^ not_lit;
+	  const signed char other_value = values[other];
+	  if (other_value > 0)
+	    {
+	      q[-2] = other;
+	      continue;
+	    }
+	  unsigned *r = c + 2;
+	  const unsigned *const end_lits = c + length;
+	  while (r != end_lits && values[*r] < 0)
+	    r++;
+	  if (r != end_lits)
+	    {
+	      c[0] = other, c[1] = *r, *r = not_lit;
+	      push (s->lists + c[1], other), push (s->lists + c[1], idx);
+	      q -= 2;
+	    }
+	  else if (other_value)
+	    conflict = 1;
+	  else
+	    assign (s, other);
+	}
+      while (p != end)
+	*q++ = *p++;
+      watches->size = q - watches->data;
+      if (conflict)
+	return 0;
+    }
+  return 1;
+}
+
+// All counters of a propagated literal are updated, even after conflicts,
+// since backtracking undoes all of them.
+
+static int
+propagate_counters (solver * s)
+{
+  counter *const counters = s->counters;
+  signed char *const values = s->values;
+  int conflict = 0;
+  while (!conflict && s->propagate < s->size)
+    {
+      const unsigned not_lit = NOT (s->trail[s->propagate++]);
+      const list *const occurrences = s->lists + not_lit;
+      const unsigned *const end = occurrences->data + occurrences->size;
+      for (const unsigned *p = occurrences->data; p != end; p++)
+	{
+	  counter *const k = counters + *p;
+	  const unsigned count = --k->count;
+	  k->sum -= not_lit;
+	  if (count > 1 || conflict)
+	    continue;
+	  const signed char value = count ? values[k->sum] : -1;
+	  if (value > 0)
+	    continue;
+	  if (value < 0)
+	    conflict = 1;
+	  else
+	    assign (s, k->sum);
+	}
+    }
+  return !conflict;
+}
+
+static void
+backtrack (solver * s)
+{
+  for (unsigned i = 0; i < s->size; i++)
+    {
+      const unsigned lit = s->trail[i];
+      if (s->counters && i < s->propagate)
+	{
+	  const unsigned not_lit = NOT (lit);
+	  const list *const occurrences = s->lists + not_lit;
+	  for (unsigned j = 0; j < occurrences->size; j++)
+	    {
+	      counter *const k = s->counters + occurrences->data[j];
+	      k->count++;
+	      k->sum += not_lit;
+	    }
+	}
+      s->values[lit] = s->values[NOT (lit)] = 0;
+    }
+  s->size = s->propagate = 0;
+}
+
+static uint64_t
+run (solver * s, const unsigned *decisions, unsigned n, unsigned depth,
+     uint64_t *conflicts, uint64_t *propagated)
+{
+  uint64_t assigned = 0;
+  unsigned level = 0;
+  for (unsigned i = 0; i < n; i++)
+    {
+      const unsigned lit = decisions[i];
+      if (s->values[lit])
+	continue;
+      assign (s, lit);
+      const unsigned before = s->propagate;
+      const int ok = s->counters ? propagate_counters (s) :
+	propagate_watches (s);
+      *propagated += s->propagate - before;
+      if (!ok)
+	{
+	  ++*conflicts;
+	  backtrack (s);
+	  level = 0;
+	}
+      else if (++level == depth)
+	{
+	  assigned += s->size;
+	  backtrack (s);
+	  level = 0;
+	}
+    }
+  backtrack (s);
+  return assigned;
+}
+
+int
+main (int argc, char **argv)
+{
+  const unsigned vars = argc > 1 ? atoi (argv[1]) : 20000;
+  const unsigned n = argc > 2 ? atoi (argv[2]) : 1000000;
+  const unsigned depth = argc > 3 ? atoi (argv[3]) : 50;
+  if (vars < 8 || !n || !depth)
+    {
+      fprintf (stderr,
+	       "usage: counters [ <variables> [ <decisions> [ <depth> ] ] ]\n");
+      return 1;
+    }
+  unsigned *decisions = malloc (n * sizeof *decisions);
+  for (unsigned i = 0; i < n; i++)
+    decisions[i] = pick (0, 2 * vars);
+  static const unsigned lengths[] = { 3, 4, 5, 7 };
+  static const double ratios[] = { 0.5, 1, 2, 4, 8 };
+  printf ("%u variables, %u decisions, backtracking after %u levels\n",
+	  vars, n, depth);
+  printf ("length ratio occurrences   watches  counters speed-up\n");
+  for (unsigned l = 0; l < sizeof lengths / sizeof *lengths; l++)
+    for (unsigned r = 0; r < sizeof ratios / sizeof *ratios; r++)
+      {
+	const unsigned length = lengths[l];
+	const double ratio = ratios[r] * (1u << (length - 3));
+	formula f;
+	generate (&f, vars, ratio * vars, length);
+	double time[2], steps[2];
+	uint64_t checks[2][2];
+	for (int counting = 0; counting < 2; counting++)
+	  {
+	    solver s;
+	    init (&s, &f, counting);
+	    uint64_t conflicts = 0, propagated = 0;
+	    const double start = seconds ();
+	    const uint64_t assigned =
+	      run (&s, decisions, n, depth, &conflicts, &propagated);
+	    time[counting] = seconds () - start;
+	    checks[counting][0] = assigned;
+	    checks[counting][1] = conflicts;
+	    steps[counting] = propagated;
+	    release (&s);
+	  }
+	free (f.lits);
+	if (memcmp (checks[0], checks[1], sizeof checks[0]))
+	  {
+	    fprintf (stderr, "counters: engines disagree\n");
+	    return 1;
+	  }
+	printf ("%6u %5.1f %11.1f %6.1f ns %6.1f ns %8.2f\n",
+		length, ratio, length * ratio / 2,
+		1e9 * time[0] / steps[0], 1e9 * time[1] / steps[1],
+		time[0] / time[1]);
+	fflush (stdout);
+      }
+  free (decisions);
+  return 0;
+}
@@ -0,0 +1,250 @@
+// Benchmark of prefetching clauses ahead in the loop over large watches
+// in 'propagate.c' (see '--prefetch').  It generates an arena of clauses
+// larger than the last level cache together with watch lists referencing
+// random clauses and values in which the given percentage of blocking
+// literals is true.  Then it visits all watch lists in random order with
+// 'lookahead' 0, 1, 2, 4, 8, 16 and 32.  For each clause with a non-true
+// blocking literal it searches for the first non-false literal, which as
+// in the propagation loop makes control flow depend on the clause, and
+// reports time and (if 'perf_event_open' is available) last level cache
+// misses per visited clause.  Standalone, build and run with
+//
+//   cc -O2 -o prefetch -I src src/measures/prefetch.c
+//   ./prefetch [ <megabytes> [ <watches> [ <true> ] ] ]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Same layout as a large watch, i.e., a head with the blocking literal
+// followed by a tail with the clause reference into the arena.
+
+typedef struct watch watch;
+
+struct watch
+{
+  unsigned blocking;
+  unsigned ref;
+};
+
+static uint64_t state = 42;
+
+static unsigned
+pick (unsigned low, unsigned high)
+{
+  state = 6364136223846793005ul * state + 1442695040888963407ul;
+  return low + (unsigned) ((state >> 32) % (high - low));
+}
+
+static double
+seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static int
+open_misses (void)
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof attr;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static void
+start_misses (int fd)
+{
+#ifdef __linux__
+  if (fd < 0)
+    return;
+  ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+#else
+  (void) fd;
+#endif
+}
+
+static uint64_t
+stop_misses (int fd)
+{
+  uint64_t res = 0;
+#ifdef __linux__
+  if (fd < 0)
+    return 0;
+  ioctl (fd, PERF_EVENT_IOC_DISABLE, 0);
+  if (read (fd, &res, sizeof res) != sizeof res)
+    res = 0;
+#else
+  (void) fd;
+#endif
+  return res;
+}
+
+// Clauses have a header word and 3 to 12 literals.  The 'values' of
+// literals are indexed by literal as in the solver.
+
+static unsigned *
+generate_arena (size_t words, unsigned lits, size_t *clauses_ptr,
+		unsigned **refs_ptr)
+{
+  unsigned *arena = malloc (words * sizeof *arena);
+  unsigned *refs = malloc ((words / 4 + 1) * sizeof *refs);
+  if (!arena || !refs)
+    return 0;
+  size_t clauses = 0, pos = 0;
+  for (;;)
+    {
+      const unsigned size = pick (3, 13);
+      if (pos + 1 + size > words)
+	break;
+      refs[clauses++] = pos;
+      arena[pos++] = size;
+      for (unsigned i = 0; i < size; i++)
+	arena[pos++] = pick (0, lits);
+    }
+  *clauses_ptr = clauses;
+  *refs_ptr = refs;
+  return arena;
+}
+
+static uint64_t
+visit (const signed char *values, const unsigned *arena,
+       const watch *begin, const watch *end, unsigned lookahead,
+       uint64_t *visited)
+{
+  uint64_t res = 0;
+  const watch *prefetched = begin;
+  unsigned pending = 0;
+  for (const watch * p = begin; p != end;)
+    {
+      const watch w = *p++;
+      if (values[w.blocking] > 0)
+	continue;
+      if (lookahead)
+	{
+	  if (prefetched < p)
+	    prefetched = p, pending = 0;
+	  else if (pending)
+	    pending--;
+	  while (pending < lookahead && prefetched != end)
+	    {
+	      const watch next = *prefetched++;
+	      if (values[next.blocking] > 0)
+		continue;
+	      __builtin_prefetch (arena + next.ref, 0, 1);
+	      pending++;
+	    }
+	}
+      const unsigned *const c = arena + w.ref;
+      const unsigned *const lits = c + 1, *const end_lits = lits + c[0];
+      const unsigned *r = lits;
+      while (r != end_lits && values[*r] < 0)
+	r++;
+      res += r - lits;
+      *visited += 1;
+    }
+  return res;
+}
+
+int
+main (int argc, char **argv)
+{
+  const unsigned megabytes = argc > 1 ? atoi (argv[1]) : 1024;
+  const unsigned watches = argc > 2 ? atoi (argv[2]) : 16;
+  const unsigned percent = argc > 3 ? atoi (argv[3]) : 25;
+  if (!megabytes || !watches || percent > 100)
+    {
+      fprintf (stderr,
+	       "usage: prefetch [ <megabytes> [ <watches> [ <true> ] ] ]\n");
+      return 1;
+    }
+  const size_t words = (size_t) megabytes << 18;
+  const unsigned lits = 1u << 20;
+  size_t clauses;
+  unsigned *refs;
+  unsigned *arena = generate_arena (words, lits, &clauses, &refs);
+  signed char *values = malloc (lits);
+  const size_t size = (size_t) watches * lits;
+  watch *all = malloc (size * sizeof *all);
+  unsigned *order = malloc (lits * sizeof *order);
+  if (!arena || !values || !all || !order)
+    {
+      fprintf (stderr, "prefetch: out of memory\n");
+      return 1;
+    }
+  for (unsigned lit = 0; lit < lits; lit++)
+    values[lit] = pick (0, 100) < percent ? 1 : -1;
+  for (size_t i = 0; i < size; i++)
+    {
+      all[i].blocking = pick (0, lits);
+      all[i].ref = refs[pick (0, clauses)];
+    }
+  for (unsigned i = 0; i < lits; i++)
+    order[i] = i;
+  for (unsigned i = lits - 1; i; i--)
+    {
+      const unsigned j = pick (0, i + 1), tmp = order[i];
+      order[i] = order[j], order[j] = tmp;
+    }
+  printf ("%zu clauses in %u MB arena, %u watches per literal, "
+	  "%u%% true blocking literals\n",
+	  clauses, megabytes, watches, percent);
+  const int fd = open_misses ();
+  if (fd < 0)
+    printf ("cache misses not available (perf_event_open failed)\n");
+  uint64_t checksum = 0;
+  double base = 0;
+  for (unsigned lookahead = 0; lookahead <= 32;
+       lookahead = lookahead ? 2 * lookahead : 1)
+    {
+      uint64_t visited = 0, sum = 0;
+      start_misses (fd);
+      const double start = seconds ();
+      for (unsigned i = 0; i < lits; i++)
+	{
+	  const watch *const begin = all + (size_t) order[i] * watches;
+	  sum += visit (values, arena, begin, begin + watches,
+			lookahead, &visited);
+	}
+      const double time = seconds () - start;
+      const uint64_t misses = stop_misses (fd);
+      if (!lookahead)
+	checksum = sum, base = time;
+      else if (sum != checksum)
+	{
+	  fprintf (stderr, "prefetch: checksum mismatch\n");
+	  return 1;
+	}
+      printf ("lookahead %2u %6.2f ns/clause speed-up %.2f", lookahead,
+	      1e9 * time / visited, base / time);
+      if (fd >= 0)
+	printf (" %.3f misses/clause", misses / (double) visited);
+      fputc ('\n', stdout);
+    }
+  free (order);
+  free (all);
+  free (values);
+  free (refs);
+  free (arena);
+  return 0;
+}
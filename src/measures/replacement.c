@@ -0,0 +1,133 @@
+// Benchmark of the replacement literal search in 'replacement.c'.  It
+// generates long clauses (30 to 100 literals as learned on cryptographic
+// instances) over random internal literals together with an assignment in
+// which most of their literals are false, as at the point where the search
+// for a replacement of a falsified watched literal starts.  Then it
+// searches all clauses repeatedly with the scalar and (if supported) the
+// SIMD version, checks that both agree and reports their throughput.
+// Standalone, build and run with
+//
+//   cc -O2 -o replacement -I src src/measures/replacement.c src/replacement.c
+//   ./replacement [ <variables> [ <clauses> [ <rounds> ] ] ]
+
+#include "replacement.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t state = 42;
+
+static unsigned
+pick (unsigned low, unsigned high)
+{
+  state = 6364136223846793005ul * state + 1442695040888963407ul;
+  return low + (unsigned) ((state >> 32) % (high - low));
+}
+
+static double
+seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// In a quarter of the clauses all literals are false, in the rest the
+// first non-false literal is at a random position.  Literals are assigned
+// consistently, i.e., 'values[lit] = -values[lit ^ 1]'.
+
+static void
+generate (unsigned vars, unsigned clauses, signed char *values,
+	  unsigned *offsets, unsigned *lits)
+{
+  for (unsigned idx = 0; idx < vars; idx++)
+    values[2 * idx] = values[2 * idx + 1] = 0;
+  unsigned *p = lits;
+  for (unsigned i = 0; i < clauses; i++)
+    {
+      offsets[i] = p - lits;
+      const unsigned size = pick (30, 101);
+      const unsigned found = pick (0, 4) ? pick (0, size) : size;
+      for (unsigned j = 0; j < size; j++)
+	{
+	  const unsigned lit = 2 * pick (0, vars) + pick (0, 2);
+	  if (j < found && values[lit] >= 0)
+	    values[lit] = -1, values[lit ^ 1] = 1;
+	  *p++ = lit;
+	}
+    }
+  offsets[clauses] = p - lits;
+}
+
+typedef unsigned *search (const signed char *, unsigned *, unsigned *);
+
+static double
+measure (search * search, unsigned clauses, unsigned rounds,
+	 const signed char *values, const unsigned *offsets, unsigned *lits,
+	 uint64_t *sum)
+{
+  const double start = seconds ();
+  uint64_t res = 0;
+  for (unsigned r = 0; r < rounds; r++)
+    for (unsigned i = 0; i < clauses; i++)
+      {
+	unsigned *const begin = lits + offsets[i];
+	unsigned *const end = lits + offsets[i + 1];
+	res += search (values, begin, end) - begin;
+      }
+  *sum = res;
+  return seconds () - start;
+}
+
+int
+main (int argc, char **argv)
+{
+  const unsigned vars = argc > 1 ? atoi (argv[1]) : 100000;
+  const unsigned clauses = argc > 2 ? atoi (argv[2]) : 10000;
+  const unsigned rounds = argc > 3 ? atoi (argv[3]) : 1000;
+  if (!vars || !clauses || !rounds)
+    {
+      fprintf (stderr,
+	       "usage: replacement [ <vars> [ <clauses> [ <rounds> ] ] ]\n");
+      return 1;
+    }
+  signed char *values = malloc (2 * (size_t) vars);
+  unsigned *offsets = malloc ((clauses + 1) * sizeof *offsets);
+  unsigned *lits = malloc (100 * (size_t) clauses * sizeof *lits);
+  if (!values || !offsets || !lits)
+    {
+      fprintf (stderr, "replacement: out of memory\n");
+      return 1;
+    }
+  generate (vars, clauses, values, offsets, lits);
+  uint64_t scalar_sum;
+  const double scalar = measure (kissat_scalar_replacement, clauses, rounds,
+				 values, offsets, lits, &scalar_sum);
+  const double mlits = scalar_sum / 1e6;	// skipped false literals
+  printf ("%u clauses over %u variables with %u literals\n",
+	  clauses, vars, offsets[clauses]);
+  printf ("scalar %.0f million literals/s\n", mlits / scalar);
+#ifdef SIMD_REPLACEMENT
+  if (kissat_simd_replacement_supported ())
+    {
+      uint64_t simd_sum;
+      const double simd = measure (kissat_simd_replacement, clauses, rounds,
+				   values, offsets, lits, &simd_sum);
+      if (simd_sum != scalar_sum)
+	{
+	  fprintf (stderr, "replacement: SIMD and scalar search differ\n");
+	  return 1;
+	}
+      printf ("SIMD %.0f million literals/s, speed-up %.2f\n",
+	      mlits / simd, scalar / simd);
+    }
+  else
+#endif
+    printf ("SIMD search not supported\n");
+  free (lits);
+  free (offsets);
+  free (values);
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include "barrier.h"
+
+#include "allocate.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+
+struct barrier
+{
+  pthread_mutex_t lock;
+  pthread_cond_t passed;
+  unsigned size;		// Number of solver threads.
+  unsigned arrived;		// Waiting in the current generation.
+  unsigned left;		// Stopped solver threads.
+  uint64_t generation;		// Number of barriers passed.
+  bool stop;			// Some thread left before the last barrier.
+};
+
+barrier *
+kissat_new_barrier (struct kissat *solver, unsigned size)
+{
+  barrier *barrier = kissat_calloc (solver, 1, sizeof *barrier);
+  pthread_mutex_init (&barrier->lock, 0);
+  pthread_cond_init (&barrier->passed, 0);
+  barrier->size = size;
+  return barrier;
+}
+
+void
+kissat_release_barrier (struct kissat *solver, barrier * barrier)
+{
+  pthread_cond_destroy (&barrier->passed);
+  pthread_mutex_destroy (&barrier->lock);
+  kissat_free (solver, barrier, sizeof *barrier);
+}
+
+// Threads woken up by passing the barrier can not wait again before all of
+// them woke up, thus 'stop' is not overwritten before all have read it.
+
+static void
+pass_barrier (barrier * barrier)
+{
+  barrier->stop = barrier->left > 0;
+  barrier->arrived = 0;
+  barrier->generation++;
+  pthread_cond_broadcast (&barrier->passed);
+}
+
+bool
+kissat_wait_barrier (barrier * barrier)
+{
+  pthread_mutex_lock (&barrier->lock);
+  assert (barrier->arrived + barrier->left < barrier->size);
+  const uint64_t generation = barrier->generation;
+  if (++barrier->arrived + barrier->left == barrier->size)
+    pass_barrier (barrier);
+  else
+    while (barrier->generation == generation)
+      pthread_cond_wait (&barrier->passed, &barrier->lock);
+  const bool res = !barrier->stop;
+  pthread_mutex_unlock (&barrier->lock);
+  return res;
+}
+
+void
+kissat_leave_barrier (barrier * barrier)
+{
+  pthread_mutex_lock (&barrier->lock);
+  assert (barrier->left < barrier->size);
+  if (++barrier->left < barrier->size &&
+      barrier->arrived + barrier->left == barrier->size)
+    pass_barrier (barrier);
+  pthread_mutex_unlock (&barrier->lock);
+}
@@ -0,0 +1,22 @@
+#ifndef _barrier_h_INCLUDED
+#define _barrier_h_INCLUDED
+
+#include <stdbool.h>
+
+// Barrier for the deterministic mode of solver threads ('--sharesync').
+// Solver threads which stopped (with or without result) leave the barrier
+// and from then on count as waiting.  Waiting returns 'false' if some
+// thread left before the barrier was passed.  This is decided once when
+// the last thread arrives, thus all threads see the same outcome.
+
+typedef struct barrier barrier;
+
+struct kissat;
+
+barrier *kissat_new_barrier (struct kissat *, unsigned size);
+void kissat_release_barrier (struct kissat *, barrier *);
+
+bool kissat_wait_barrier (barrier *);
+void kissat_leave_barrier (barrier *);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _buffer_h_INCLUDED
+#define _buffer_h_INCLUDED
+
+#include "error.h"
+
+#include <stdlib.h>
+
+// Memory owned by helper threads (background elimination, vivification
+// and local search) can not be allocated with 'kissat_malloc' and friends,
+// since these update the statistics of the solver without locking.  Helper
+// threads use 'REALLOCATE_BUFFER' on plain arrays and the 'BUFFER' stacks
+// below instead, which are released with 'free'.
+
+#define BUFFER(TYPE) \
+struct { TYPE * begin; size_t size, capacity; }
+
+#define PUSH_BUFFER(B,E) \
+do { \
+  if ((B).size == (B).capacity) \
+    (B).begin = kissat_enlarge_buffer ((B).begin, &(B).capacity, \
+                                       sizeof *(B).begin); \
+  (B).begin[(B).size++] = (E); \
+} while (0)
+
+#define REALLOCATE_BUFFER(P,N) \
+do { \
+  (P) = kissat_reallocate_buffer ((P), (N) * sizeof *(P)); \
+} while (0)
+
+#define RELEASE_BUFFER(B) \
+do { \
+  free ((B).begin); \
+  (B).begin = 0; \
+  (B).size = (B).capacity = 0; \
+} while (0)
+
+static inline void *
+kissat_reallocate_buffer (void *ptr, size_t bytes)
+{
+  void *res = realloc (ptr, bytes);
+  if (bytes && !res)
+    kissat_fatal ("out-of-memory in helper thread reallocating %zu bytes",
+		  bytes);
+  return res;
+}
+
+static inline void *
+kissat_enlarge_buffer (void *ptr, size_t * capacity_ptr, size_t bytes)
+{
+  const size_t capacity = *capacity_ptr ? 2 * *capacity_ptr : 16;
+  *capacity_ptr = capacity;
+  return kissat_reallocate_buffer (ptr, capacity * bytes);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "codec.h"
+
+#include <assert.h>
+#include <limits.h>
+
+// Each 32-bit number needs at most five bytes.  The size of a clause takes
+// the place of its zero sentinel and the origin is one more number.
+
+size_t
+kissat_encoded_batch_bound (size_t size)
+{
+  return 5 * (size + 1);
+}
+
+static unsigned char *
+encode_number (unsigned x, unsigned char *p)
+{
+  while (x & ~0x7fu)
+    {
+      *p++ = (x & 0x7f) | 0x80;
+      x >>= 7;
+    }
+  *p++ = x;
+  return p;
+}
+
+static unsigned
+encode_literal (int elit)
+{
+  assert (elit && elit != INT_MIN);
+  return 2u * (unsigned) (elit < 0 ? -elit : elit) + (elit < 0);
+}
+
+size_t
+kissat_encode_batch (int origin, size_t size, const int *batch,
+		     unsigned char *bytes)
+{
+  assert (origin >= 0);
+  unsigned char *p = encode_number (origin, bytes);
+  const int *q = batch;
+  const int *const end = batch + size;
+  while (q != end)
+    {
+      const unsigned glue = *q++;
+      const int *const lits = q;
+      while (*q)
+	q++;
+      p = encode_number (glue, p);
+      p = encode_number (q - lits, p);
+      unsigned prev = 0;
+      for (const int *l = lits; l != q; l++)
+	{
+	  const unsigned ulit = encode_literal (*l);
+	  assert (prev < ulit);
+	  p = encode_number (ulit - prev, p);
+	  prev = ulit;
+	}
+      q++;
+    }
+  return p - bytes;
+}
+
+static const unsigned char *
+decode_number (const unsigned char *p, const unsigned char *end,
+	       unsigned *res)
+{
+  unsigned x = 0, shift = 0;
+  for (;;)
+    {
+      if (p == end || shift > 28)
+	return 0;
+      const unsigned ch = *p++;
+      x |= (ch & 0x7f) << shift;
+      if (!(ch & 0x80))
+	break;
+      shift += 7;
+    }
+  *res = x;
+  return p;
+}
+
+// Every number takes at least one byte, so a batch of 'size' bytes decodes
+// into at most 'size' integers (origin and clause sizes are not stored,
+// but make up for the zero sentinels).  Returns 'false' for malformed
+// input, in which case the content of 'batch' is undefined.
+
+bool
+kissat_decode_batch (size_t size, const unsigned char *bytes,
+		     int *origin, size_t *decoded, int *batch)
+{
+  const unsigned char *p = bytes;
+  const unsigned char *const end = bytes + size;
+  unsigned tmp;
+  if (!(p = decode_number (p, end, &tmp)) || tmp > INT_MAX)
+    return false;
+  *origin = tmp;
+  int *q = batch;
+  while (p != end)
+    {
+      unsigned glue, lits;
+      if (!(p = decode_number (p, end, &glue)) || glue > INT_MAX)
+	return false;
+      if (!(p = decode_number (p, end, &lits)) || lits > (size_t) (end - p))
+	return false;
+      *q++ = glue;
+      unsigned ulit = 0;
+      while (lits--)
+	{
+	  unsigned delta;
+	  if (!(p = decode_number (p, end, &delta)) || !delta)
+	    return false;
+	  if (delta > UINT_MAX - ulit)
+	    return false;
+	  ulit += delta;
+	  if (ulit < 2)
+	    return false;
+	  const int idx = ulit / 2;
+	  *q++ = (ulit & 1) ? -idx : idx;
+	}
+      *q++ = 0;
+    }
+  *decoded = q - batch;
+  assert (*decoded <= size);
+  return true;
+}
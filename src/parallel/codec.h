@@ -0,0 +1,27 @@
+#ifndef _codec_h_INCLUDED
+#define _codec_h_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Wire format of clause batches sent between ranks.  In memory a batch is
+// a sequence of clauses 'glue lits... 0' of external literals sorted by
+// their DRAT encoding '2*idx + sign' (see 'share.c').  On the wire it
+// starts with the origin rank followed by the clauses, each encoded as its
+// glue, its size and the deltas between consecutive literal encodings
+// (the first literal relative to zero).  All numbers are variable-length
+// integers with seven bits per byte, least significant first and the high
+// bit set on all but the last byte (as in binary DRAT proofs).
+//
+// Batches are passed as plain 'int' arrays and no solver is needed, since
+// 'measures/codec.c' links 'codec.c' alone (see 'measures/README').
+
+size_t kissat_encoded_batch_bound (size_t size);
+
+size_t kissat_encode_batch (int origin, size_t size, const int *batch,
+			    unsigned char *bytes);
+
+bool kissat_decode_batch (size_t size, const unsigned char *bytes,
+			  int *origin, size_t *decoded, int *batch);
+
+#endif
@@ -0,0 +1,252 @@
+#include "covering.h"
+
+#include "allocate.h"
+#include "internal.h"
+#include "print.h"
+#include "random.h"
+
+#include <string.h>
+
+#ifndef NOPTIONS
+
+// Number of randomized candidates generated for each configuration.
+
+#define CANDIDATES 16
+
+// Options with a small domain which are still never diversified, either
+// since they do not change search or since disabling them only makes the
+// solver slower (similar to the list of invalid pairs in 'gencombi').
+// Without 'reluctant' the solver never restarts in stable mode and thus
+// would never exchange clauses and facts.  The arena options only change
+// memory layout, 'simd' only vectorizes the replacement watch search, and
+// 'vivifybackground' starts a helper thread per solver, which is a
+// parallel mode on its own.
+
+static const char *fixed[] = {
+  "arenahuge", "arenamap", "bump", "check", "embedded", "incremental",
+  "minimize", "phasesaving", "quiet", "reduce", "reluctant", "restart",
+  "simd", "simplify", "statistics", "vivifybackground",
+  0,				// Zero sentinel
+};
+
+static bool
+diversify (const opt * o)
+{
+  if (o->high - o->low > 2)
+    return false;
+  if (!strncmp (o->name, "share", 5))
+    return false;
+  for (const char **p = fixed; *p; p++)
+    if (!strcmp (*p, o->name))
+      return false;
+  return true;
+}
+
+typedef struct covering covering;
+
+// Each value of each diversified option (a factor) gets a column and the
+// pairs of columns already covered are kept in a (symmetric) matrix.
+
+struct covering
+{
+  unsigned factors;
+  unsigned columns;
+  const opt **options;
+  unsigned *first;
+  bool *covered;
+  uint64_t pairs;
+  uint64_t uncovered;
+};
+
+static unsigned
+values (const covering * covering, unsigned factor)
+{
+  const opt *o = covering->options[factor];
+  return o->high - o->low + 1;
+}
+
+static void
+init_covering (kissat * solver, covering * covering)
+{
+  memset (covering, 0, sizeof *covering);
+  for (all_options (o))
+    if (diversify (o))
+      covering->factors++;
+  const unsigned factors = covering->factors;
+  covering->options =
+    kissat_calloc (solver, factors, sizeof *covering->options);
+  covering->first = kissat_calloc (solver, factors, sizeof (unsigned));
+  unsigned factor = 0;
+  for (all_options (o))
+    if (diversify (o))
+      covering->options[factor++] = o;
+  for (unsigned f = 0; f < factors; f++)
+    {
+      const unsigned v = values (covering, f);
+      covering->pairs += (uint64_t) covering->columns * v;
+      covering->first[f] = covering->columns;
+      covering->columns += v;
+    }
+  const size_t columns = covering->columns;
+  covering->covered = kissat_calloc (solver, columns * columns, 1);
+  covering->uncovered = covering->pairs;
+}
+
+static void
+release_covering (kissat * solver, covering * covering)
+{
+  const size_t columns = covering->columns;
+  const unsigned factors = covering->factors;
+  kissat_dealloc (solver, covering->covered, columns * columns, 1);
+  kissat_dealloc (solver, covering->first, factors, sizeof (unsigned));
+  kissat_dealloc (solver, covering->options, factors,
+		  sizeof *covering->options);
+}
+
+static bool *
+covered (covering * covering, unsigned a, unsigned b)
+{
+  return covering->covered + (size_t) a * covering->columns + b;
+}
+
+static void
+cover_row (covering * covering, const unsigned *row)
+{
+  const unsigned factors = covering->factors;
+  for (unsigned f = 0; f < factors; f++)
+    {
+      const unsigned a = covering->first[f] + row[f];
+      for (unsigned g = f + 1; g < factors; g++)
+	{
+	  const unsigned b = covering->first[g] + row[g];
+	  bool *p = covered (covering, a, b);
+	  if (*p)
+	    continue;
+	  *p = *covered (covering, b, a) = true;
+	  assert (covering->uncovered);
+	  covering->uncovered--;
+	}
+    }
+}
+
+// Options are assigned in random order.  The value of the next option is
+// the one which covers most new pairs with the options assigned before,
+// where ties are broken by starting at a random value.
+
+static uint64_t
+generate_candidate (covering * covering, generator * random,
+		    unsigned *order, unsigned *row)
+{
+  const unsigned factors = covering->factors;
+  for (unsigned i = 0; i < factors; i++)
+    order[i] = i;
+  for (unsigned i = 0; i + 1 < factors; i++)
+    {
+      const unsigned j = kissat_pick_random (random, i, factors);
+      const unsigned tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+  uint64_t res = 0;
+  for (unsigned i = 0; i < factors; i++)
+    {
+      const unsigned f = order[i];
+      const unsigned v = values (covering, f);
+      const unsigned start = kissat_pick_random (random, 0, v);
+      unsigned best_value = start, best_gain = 0;
+      for (unsigned k = 0; k < v; k++)
+	{
+	  const unsigned value = (start + k) % v;
+	  const unsigned a = covering->first[f] + value;
+	  unsigned gain = 0;
+	  for (unsigned j = 0; j < i; j++)
+	    {
+	      const unsigned g = order[j];
+	      const unsigned b = covering->first[g] + row[g];
+	      gain += !*covered (covering, a, b);
+	    }
+	  if (gain <= best_gain)
+	    continue;
+	  best_value = value;
+	  best_gain = gain;
+	}
+      row[f] = best_value;
+      res += best_gain;
+    }
+  return res;
+}
+
+void
+kissat_configure_covering (kissat * solver, unsigned id, unsigned size)
+{
+  assert (id < size);
+  covering covering;
+  init_covering (solver, &covering);
+  const unsigned factors = covering.factors;
+  unsigned *row = kissat_calloc (solver, factors, sizeof (unsigned));
+  unsigned *best = kissat_calloc (solver, factors, sizeof (unsigned));
+  unsigned *mine = kissat_calloc (solver, factors, sizeof (unsigned));
+  unsigned *order = kissat_calloc (solver, factors, sizeof (unsigned));
+  for (unsigned f = 0; f < factors; f++)
+    {
+      const opt *o = covering.options[f];
+      best[f] = o->value - o->low;
+    }
+  generator random = size;
+  for (unsigned r = 0; r < size; r++)
+    {
+      if (r)
+	{
+	  uint64_t best_gain = 0;
+	  for (unsigned c = 0; c < CANDIDATES; c++)
+	    {
+	      const uint64_t gain =
+		generate_candidate (&covering, &random, order, row);
+	      if (c && gain <= best_gain)
+		continue;
+	      memcpy (best, row, factors * sizeof (unsigned));
+	      best_gain = gain;
+	    }
+	}
+      cover_row (&covering, best);
+      if (r == id)
+	memcpy (mine, best, factors * sizeof (unsigned));
+    }
+  if (!id)
+    kissat_message (solver, "%u configurations cover %" PRIu64 " of %"
+		    PRIu64 " pairs of values of %u options (%.0f%%)", size,
+		    covering.pairs - covering.uncovered, covering.pairs,
+		    factors, kissat_percent (covering.pairs -
+					     covering.uncovered,
+					     covering.pairs));
+  unsigned changed = 0;
+  for (unsigned f = 0; f < factors; f++)
+    {
+      const opt *o = covering.options[f];
+      const int value = o->low + (int) mine[f];
+      if (value == o->value)
+	continue;
+      kissat_verbose (solver, "covering sets '--%s=%d'", o->name, value);
+      kissat_set_option (solver, o->name, value);
+      changed++;
+    }
+  kissat_message (solver, "solver %u of %u changes %u of %u options",
+		  id, size, changed, factors);
+  kissat_dealloc (solver, order, factors, sizeof (unsigned));
+  kissat_dealloc (solver, mine, factors, sizeof (unsigned));
+  kissat_dealloc (solver, best, factors, sizeof (unsigned));
+  kissat_dealloc (solver, row, factors, sizeof (unsigned));
+  release_covering (solver, &covering);
+}
+
+#else
+
+void
+kissat_configure_covering (kissat * solver, unsigned id, unsigned size)
+{
+  (void) solver;
+  (void) id;
+  (void) size;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _covering_h_INCLUDED
+#define _covering_h_INCLUDED
+
+struct kissat;
+
+// Runtime counterpart of 'gencombi': instead of covering all pairs of
+// compile-time features with as few configurations as possible, we cover
+// as many pairs of runtime option values as possible with a given number
+// of solvers (ranks or threads).  All options in the 'OPTION' table with
+// at most three values are diversified, except those which only influence
+// output, checking or the parallel modes themselves.
+//
+// The covering array is built greedily (as in AETG), one configuration at
+// a time, starting with the default configuration for solver zero.  Each
+// further configuration is the best of several randomized candidates,
+// where the value of every option is picked to cover as many uncovered
+// pairs as possible.  The construction is deterministic, so all ranks and
+// threads compute the same array and just select their own row.
+
+void kissat_configure_covering (struct kissat *, unsigned id, unsigned size);
+
+#endif
@@ -0,0 +1,538 @@
+#include "cube.h"
+#include "portfolio.h"
+
+#include "allocate.h"
+#include "backtrack.h"
+#include "decide.h"
+#include "inline.h"
+#include "print.h"
+
+#include <inttypes.h>
+#include <mpi.h>
+#include <string.h>
+
+#define COORDINATOR 0
+
+// All cube messages go through a duplicate of 'MPI_COMM_WORLD', so that
+// receiving any tag never picks up announcements or clause batches.
+
+#define REQUEST_TAG 1		// Worker wants a (new) cube.
+#define CUBE_TAG 2		// Coordinator sends cube to idle worker.
+#define STEAL_TAG 3		// Coordinator asks busy worker to split.
+#define SPLIT_TAG 4		// Worker returns split off cube (or nothing).
+#define RESULT_TAG 5		// Worker found result or gave up.
+#define DONE_TAG 6		// Coordinator stops workers.
+#define BYE_TAG 7		// Last message of a worker.
+
+typedef struct cube cube;
+
+struct cube
+{
+  bool fetched;			// Got a cube from the coordinator.
+  bool done;			// Coordinator stopped us.
+  ints external;		// Current cube as external literals.
+  unsigneds assumptions;	// Current cube as internal literals.
+  ints message;			// Receive buffer.
+  uint64_t cubes;		// Number of cubes solved.
+  uint64_t splits;		// Number of cubes split off.
+};
+
+static MPI_Comm comm;
+
+bool
+kissat_cube_coordinator (int rank)
+{
+  return kissat_portfolio_cubing () && rank == COORDINATOR;
+}
+
+// Receiving messages of unknown length is always done in the same way by
+// probing first, then adjusting the buffer and then actually receiving.
+
+static int
+receive_message (kissat * solver, ints * message, int source, int *from)
+{
+  MPI_Status status;
+  MPI_Probe (source, MPI_ANY_TAG, comm, &status);
+  int count;
+  MPI_Get_count (&status, MPI_INT, &count);
+  CLEAR_STACK (*message);
+  while (CAPACITY_STACK (*message) < (size_t) count)
+    kissat_stack_enlarge (solver, (chars *) message, sizeof (int));
+  MPI_Recv (BEGIN_STACK (*message), count, MPI_INT, status.MPI_SOURCE,
+	    status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+  message->end = message->begin + count;
+  if (from)
+    *from = status.MPI_SOURCE;
+  return status.MPI_TAG;
+}
+
+static void
+send_message (ints * message, int destination, int tag)
+{
+  MPI_Send (BEGIN_STACK (*message), SIZE_STACK (*message), MPI_INT,
+	    destination, tag, comm);
+}
+
+static void
+send_value (int value, int destination, int tag)
+{
+  MPI_Send (&value, 1, MPI_INT, destination, tag, comm);
+}
+
+/*------------------------------------------------------------------------*/
+
+// Workers.
+
+static unsigned
+import_cube_literal (kissat * solver, int elit)
+{
+  const unsigned eidx = ABS (elit);
+  if (eidx >= SIZE_STACK (solver->import))
+    return INVALID_LIT;
+  const import *const import = &PEEK_STACK (solver->import, eidx);
+  if (!import->imported || import->eliminated)
+    return INVALID_LIT;
+  unsigned ilit = import->lit;
+  if (elit < 0)
+    ilit = NOT (ilit);
+  return ilit;
+}
+
+// Splitting requires a decision after the assumptions, which are always
+// decided first.  We keep the positive branch of that decision and hand
+// the negative branch to the coordinator.
+
+static unsigned
+first_non_assumption_decision (kissat * solver, cube * cube)
+{
+  for (unsigned level = 1; level <= solver->level; level++)
+    {
+      const unsigned decision = FRAME (level).decision;
+      bool assumed = false;
+      for (all_stack (unsigned, lit, cube->assumptions))
+	if ((assumed = (lit == decision)))
+	  break;
+      if (!assumed)
+	return decision;
+    }
+  return INVALID_LIT;
+}
+
+static void
+split_cube (kissat * solver, cube * cube)
+{
+  const unsigned decision = first_non_assumption_decision (solver, cube);
+  CLEAR_STACK (cube->message);
+  if (decision != INVALID_LIT)
+    {
+      const int elit = kissat_export_literal (solver, decision);
+      assert (elit);
+      for (all_stack (int, other, cube->external))
+	PUSH_STACK (cube->message, other);
+      PUSH_STACK (cube->message, -elit);
+      PUSH_STACK (cube->external, elit);
+      PUSH_STACK (cube->assumptions, decision);
+      cube->splits++;
+      LOG ("split off cube on decision %s", LOGLIT (decision));
+    }
+  send_message (&cube->message, COORDINATOR, SPLIT_TAG);
+}
+
+static void
+stop_worker (kissat * solver, cube * cube)
+{
+  cube->done = true;
+  kissat_terminate (solver);
+}
+
+void
+kissat_poll_cube (kissat * solver)
+{
+  cube *cube = solver->cube;
+  if (!cube)
+    return;
+  int flag;
+  MPI_Iprobe (COORDINATOR, MPI_ANY_TAG, comm, &flag, MPI_STATUS_IGNORE);
+  if (!flag)
+    return;
+  const int tag = receive_message (solver, &cube->message, COORDINATOR, 0);
+  if (tag == STEAL_TAG)
+    split_cube (solver, cube);
+  else
+    {
+      assert (tag == DONE_TAG);
+      stop_worker (solver, cube);
+    }
+}
+
+// Blocks until the coordinator sends a new cube, or stops us.  Literals
+// fixed at the root level are dropped from the cube and if one of them is
+// falsified the whole cube is refuted immediately.
+
+static void
+fetch_cube (kissat * solver, cube * cube)
+{
+  assert (!solver->level);
+  for (;;)
+    {
+      send_value (0, COORDINATOR, REQUEST_TAG);
+      int tag;
+      while ((tag = receive_message (solver, &cube->message,
+				     COORDINATOR, 0)) == STEAL_TAG)
+	{
+	  CLEAR_STACK (cube->message);
+	  send_message (&cube->message, COORDINATOR, SPLIT_TAG);
+	}
+      if (tag == DONE_TAG)
+	{
+	  stop_worker (solver, cube);
+	  return;
+	}
+      assert (tag == CUBE_TAG);
+      CLEAR_STACK (cube->external);
+      CLEAR_STACK (cube->assumptions);
+      bool refuted = false;
+      for (all_stack (int, elit, cube->message))
+	{
+	  const unsigned ilit = import_cube_literal (solver, elit);
+	  assert (ilit != INVALID_LIT);
+	  const value value = kissat_fixed (solver, ilit);
+	  if (value < 0)
+	    refuted = true;
+	  if (value)
+	    continue;
+	  PUSH_STACK (cube->external, elit);
+	  PUSH_STACK (cube->assumptions, ilit);
+	}
+      cube->cubes++;
+      if (!refuted)
+	break;
+      LOG ("cube refuted at the root level");
+    }
+  cube->fetched = true;
+  kissat_verbose (solver, "rank %d solving cube %" PRIu64 " of size %zu",
+		  kissat_portfolio_rank (), cube->cubes,
+		  SIZE_STACK (cube->assumptions));
+}
+
+bool
+kissat_cubing (kissat * solver)
+{
+  cube *cube = solver->cube;
+  if (!cube)
+    return false;
+  if (!cube->fetched)
+    return true;
+  for (all_stack (unsigned, lit, cube->assumptions))
+    if (VALUE (lit) <= 0)
+      return true;
+  return false;
+}
+
+// Assumptions are decided before any other decision.  Thus if one of them
+// is falsified, the formula together with the assumptions decided before
+// implies its negation and the cube is refuted.
+
+void
+kissat_decide_cube (kissat * solver)
+{
+  cube *cube = solver->cube;
+  assert (cube);
+  for (;;)
+    {
+      if (!cube->fetched)
+	fetch_cube (solver, cube);
+      if (cube->done)
+	return;
+      for (all_stack (unsigned, lit, cube->assumptions))
+	{
+	  const value value = VALUE (lit);
+	  if (value > 0)
+	    continue;
+	  if (!value)
+	    {
+	      kissat_internal_assume (solver, lit);
+	      return;
+	    }
+	  LOG ("assumption %s falsified", LOGLIT (lit));
+	  cube->fetched = false;
+	  break;
+	}
+      if (cube->fetched)
+	return;
+      kissat_backtrack_in_consistent_state (solver, 0);
+    }
+}
+
+static void
+finish_worker (kissat * solver, cube * cube, int res)
+{
+  if (!cube->done)
+    {
+      send_value (res, COORDINATOR, RESULT_TAG);
+      int tag;
+      while ((tag = receive_message (solver, &cube->message,
+				     COORDINATOR, 0)) == STEAL_TAG)
+	{
+	  CLEAR_STACK (cube->message);
+	  send_message (&cube->message, COORDINATOR, SPLIT_TAG);
+	}
+      assert (tag == DONE_TAG);
+      cube->done = true;
+    }
+  send_value (0, COORDINATOR, BYE_TAG);
+}
+
+static int
+conquer (kissat * solver)
+{
+  // Cubes refer to variables which thus have to stay around.
+  kissat_set_option (solver, "eliminate", 0);
+  kissat_set_option (solver, "substitute", 0);
+  kissat_set_option (solver, "sweep", 0);
+
+  cube *cube = kissat_calloc (solver, 1, sizeof *cube);
+  solver->cube = cube;
+  const int res = kissat_solve (solver);
+  finish_worker (solver, cube, res);
+  kissat_verbose (solver, "solved %" PRIu64 " cubes and split off %"
+		  PRIu64, cube->cubes, cube->splits);
+  solver->cube = 0;
+  RELEASE_STACK (cube->external);
+  RELEASE_STACK (cube->assumptions);
+  RELEASE_STACK (cube->message);
+  kissat_free (solver, cube, sizeof *cube);
+  return res == 10 ? 10 : 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+// Coordinator.
+
+typedef struct coordinator coordinator;
+
+struct coordinator
+{
+  ints queue;			// Cubes to be solved (zero terminated).
+  size_t head;			// Next cube in 'queue'.
+  unsigneds idle;		// Workers waiting for a cube.
+  bool *busy;			// Workers solving a cube.
+  int workers;			// Number of workers.
+  int stealing;			// Worker asked to split (or zero).
+  int next;			// Next worker to ask to split.
+  ints message;			// Receive and send buffer.
+};
+
+static unsigned
+cube_depth (kissat * solver, int workers)
+{
+  unsigned res = GET_OPTION (cubedepth);
+  if (!res)
+    while ((1u << res) < 4u * (unsigned) workers)
+      res++;
+  return res;
+}
+
+// Select the unassigned active variables with the highest scores with
+// insertion into a small sorted array and push all their sign combinations
+// as cubes.
+
+static void
+generate_cubes (kissat * solver, coordinator * coordinator)
+{
+  const unsigned depth = cube_depth (solver, coordinator->workers);
+  unsigned *selected = kissat_nalloc (solver, depth, sizeof (unsigned));
+  unsigned size = 0;
+  heap *scores = SCORES;
+  for (all_variables (idx))
+    {
+      if (!ACTIVE (idx))
+	continue;
+      if (kissat_fixed (solver, LIT (idx)))
+	continue;
+      const double score = kissat_get_heap_score (scores, idx);
+      unsigned i = size;
+      while (i && kissat_get_heap_score (scores, selected[i - 1]) < score)
+	i--;
+      if (i == depth)
+	continue;
+      if (size < depth)
+	size++;
+      for (unsigned j = size - 1; j > i; j--)
+	selected[j] = selected[j - 1];
+      selected[i] = idx;
+    }
+  const unsigned cubes = 1u << size;
+  for (unsigned signs = 0; signs < cubes; signs++)
+    {
+      for (unsigned i = 0; i < size; i++)
+	{
+	  const unsigned lit = LIT (selected[i]) ^ ((signs >> i) & 1);
+	  PUSH_STACK (coordinator->queue, kissat_export_literal (solver, lit));
+	}
+      PUSH_STACK (coordinator->queue, 0);
+    }
+  kissat_dealloc (solver, selected, depth, sizeof (unsigned));
+  kissat_message (solver, "split formula on %u variables into %u cubes",
+		  size, cubes);
+}
+
+static void
+enqueue_cube (kissat * solver, coordinator * coordinator)
+{
+  for (all_stack (int, elit, coordinator->message))
+    PUSH_STACK (coordinator->queue, elit);
+  PUSH_STACK (coordinator->queue, 0);
+}
+
+static bool
+dequeue_cube (kissat * solver, coordinator * coordinator)
+{
+  ints *queue = &coordinator->queue;
+  if (coordinator->head == SIZE_STACK (*queue))
+    return false;
+  CLEAR_STACK (coordinator->message);
+  const int *p = BEGIN_STACK (*queue) + coordinator->head;
+  int elit;
+  while ((elit = *p++))
+    PUSH_STACK (coordinator->message, elit);
+  coordinator->head = p - BEGIN_STACK (*queue);
+  if (coordinator->head == SIZE_STACK (*queue))
+    {
+      CLEAR_STACK (*queue);
+      coordinator->head = 0;
+    }
+  return true;
+}
+
+static void
+steal_cube (coordinator * coordinator)
+{
+  if (coordinator->stealing)
+    return;
+  const int workers = coordinator->workers;
+  for (int i = 0; i < workers; i++)
+    {
+      const int worker = 1 + (coordinator->next + i) % workers;
+      if (!coordinator->busy[worker])
+	continue;
+      coordinator->next = worker % workers;
+      coordinator->stealing = worker;
+      send_value (0, worker, STEAL_TAG);
+      return;
+    }
+}
+
+// Hands out queued cubes to idle workers, steals if there are idle workers
+// but no cubes left and returns 'true' if all cubes have been refuted.
+
+static bool
+dispatch_cubes (kissat * solver, coordinator * coordinator)
+{
+  while (!EMPTY_STACK (coordinator->idle) && dequeue_cube (solver, coordinator))
+    {
+      const int worker = POP_STACK (coordinator->idle);
+      coordinator->busy[worker] = true;
+      send_message (&coordinator->message, worker, CUBE_TAG);
+    }
+  if (EMPTY_STACK (coordinator->idle))
+    return false;
+  steal_cube (coordinator);
+  if (coordinator->stealing)
+    return false;
+  return SIZE_STACK (coordinator->idle) == (size_t) coordinator->workers;
+}
+
+// The worker which found a satisfying assignment prints it, thus the
+// coordinator only reports unsatisfiability.
+
+static int
+distribute_cubes (kissat * solver, coordinator * coordinator)
+{
+  int res = 0;
+  for (;;)
+    {
+      int worker;
+      const int tag = receive_message (solver, &coordinator->message,
+				       MPI_ANY_SOURCE, &worker);
+      if (tag == REQUEST_TAG)
+	{
+	  coordinator->busy[worker] = false;
+	  PUSH_STACK (coordinator->idle, worker);
+	}
+      else if (tag == SPLIT_TAG)
+	{
+	  assert (coordinator->stealing == worker);
+	  coordinator->stealing = 0;
+	  if (!EMPTY_STACK (coordinator->message))
+	    enqueue_cube (solver, coordinator);
+	}
+      else
+	{
+	  assert (tag == RESULT_TAG);
+	  res = PEEK_STACK (coordinator->message, 0);
+	  kissat_message (solver, "worker %d reported result %d",
+			  worker, res);
+	  break;
+	}
+      if (dispatch_cubes (solver, coordinator))
+	{
+	  kissat_message (solver, "all cubes refuted");
+	  res = 20;
+	  break;
+	}
+    }
+  return res == 10 ? 0 : res;
+}
+
+static void
+finish_coordinator (kissat * solver, coordinator * coordinator)
+{
+  for (int worker = 1; worker <= coordinator->workers; worker++)
+    send_value (0, worker, DONE_TAG);
+  int byes = 0;
+  while (byes < coordinator->workers)
+    if (receive_message (solver, &coordinator->message,
+			 MPI_ANY_SOURCE, 0) == BYE_TAG)
+      byes++;
+}
+
+static int
+coordinate (kissat * solver)
+{
+  coordinator coordinator;
+  memset (&coordinator, 0, sizeof coordinator);
+  coordinator.workers = kissat_portfolio_size () - 1;
+  coordinator.busy =
+    kissat_calloc (solver, coordinator.workers + 1, sizeof (bool));
+  kissat_set_option (solver, "stable", 2);
+  kissat_set_conflict_limit (solver, GET_OPTION (cubeconflicts));
+  int res = kissat_solve (solver);
+  if (!res)
+    {
+      generate_cubes (solver, &coordinator);
+      res = distribute_cubes (solver, &coordinator);
+    }
+  finish_coordinator (solver, &coordinator);
+  RELEASE_STACK (coordinator.queue);
+  RELEASE_STACK (coordinator.idle);
+  RELEASE_STACK (coordinator.message);
+  kissat_dealloc (solver, coordinator.busy,
+		  coordinator.workers + 1, sizeof (bool));
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+int
+kissat_solve_cubes (kissat * solver)
+{
+  MPI_Comm_dup (MPI_COMM_WORLD, &comm);
+  int res;
+  if (kissat_portfolio_rank () == COORDINATOR)
+    res = coordinate (solver);
+  else
+    res = conquer (solver);
+  MPI_Comm_free (&comm);
+  return res;
+}
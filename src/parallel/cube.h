@@ -0,0 +1,23 @@
+#ifndef _cube_h_INCLUDED
+#define _cube_h_INCLUDED
+
+#include <stdbool.h>
+
+struct kissat;
+
+// Running 'mpirun -np N ssat --cube ...' uses rank zero as coordinator.
+// It runs a short stable mode search to obtain VSIDS scores and splits the
+// formula on the variables with the highest scores into cubes (prefixes of
+// assumptions).  The other ranks are workers solving one cube at a time
+// under these assumptions.  If the coordinator runs out of cubes it asks a
+// busy worker to split off the remaining subtree under its first decision.
+
+int kissat_solve_cubes (struct kissat *);
+
+bool kissat_cubing (struct kissat *);
+void kissat_decide_cube (struct kissat *);
+void kissat_poll_cube (struct kissat *);
+
+bool kissat_cube_coordinator (int rank);
+
+#endif
@@ -0,0 +1,433 @@
+#include "elimination.h"
+#include "buffer.h"
+
+#include "allocate.h"
+#include "eliminate.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+#include "terminate.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct candidate candidate;
+typedef struct resolver resolver;
+typedef struct scheduler scheduler;
+
+struct candidate
+{
+  unsigned lit;			// Resolved literal (fewer occurrences).
+  unsigned occurrences;		// Clauses with the variable.
+  unsigned resolver;		// Resolver which generated resolvents.
+  bool eliminate;		// Resolvents within bound generated.
+  size_t begin, end;		// Resolvents in buffer of resolver.
+};
+
+// *INDENT-OFF*
+typedef BUFFER (unsigned) ubuffer;
+// *INDENT-ON*
+
+struct resolver
+{
+  pthread_t thread;
+  scheduler *scheduler;
+  value *marks;
+  ubuffer resolvents;
+  uint64_t resolutions;
+};
+
+// *INDENT-OFF*
+typedef STACK (candidate) candidates;
+// *INDENT-ON*
+
+struct scheduler
+{
+  kissat *solver;
+  unsigned size;		// Number of resolvers.
+  resolver *resolvers;
+  bool *touched;		// Variables in scheduled neighborhoods.
+  bool *tried;			// Candidates scheduled in this round.
+  unsigneds neighbors;		// Touched variables (to reset them).
+  candidates candidates;
+  _Atomic (unsigned) next;	// Next candidate to resolve.
+};
+
+static void
+init_scheduler (kissat * solver, scheduler * scheduler)
+{
+  memset (scheduler, 0, sizeof *scheduler);
+  scheduler->solver = solver;
+  const unsigned size = GET_OPTION (eliminatethreads);
+  scheduler->size = size;
+  scheduler->resolvers = kissat_calloc (solver, size, sizeof (resolver));
+  for (unsigned i = 0; i < size; i++)
+    {
+      resolver *resolver = scheduler->resolvers + i;
+      resolver->scheduler = scheduler;
+      resolver->marks = kissat_calloc (solver, LITS, sizeof (value));
+    }
+  scheduler->touched = kissat_calloc (solver, VARS, sizeof (bool));
+  scheduler->tried = kissat_calloc (solver, VARS, sizeof (bool));
+}
+
+static void
+release_scheduler (kissat * solver, scheduler * scheduler)
+{
+  const unsigned size = scheduler->size;
+  for (unsigned i = 0; i < size; i++)
+    {
+      resolver *resolver = scheduler->resolvers + i;
+      kissat_dealloc (solver, resolver->marks, LITS, sizeof (value));
+      RELEASE_BUFFER (resolver->resolvents);
+    }
+  kissat_dealloc (solver, scheduler->resolvers, size, sizeof (resolver));
+  kissat_dealloc (solver, scheduler->touched, VARS, sizeof (bool));
+  kissat_dealloc (solver, scheduler->tried, VARS, sizeof (bool));
+  RELEASE_STACK (scheduler->neighbors);
+  RELEASE_STACK (scheduler->candidates);
+}
+
+/*------------------------------------------------------------------------*/
+
+// Binary clauses only live in watches and are mapped to a temporary
+// clause as during sequential resolution.  Returns zero for garbage and
+// root-level satisfied clauses, which are ignored.
+
+static clause *
+watch_to_clause (kissat * solver, clause * tmp, unsigned lit, watch watch)
+{
+  const value *const values = solver->values;
+  clause *res;
+  if (watch.type.binary)
+    {
+      const unsigned other = watch.binary.lit;
+      if (values[other] > 0)
+	return 0;
+      tmp->lits[0] = lit;
+      tmp->lits[1] = other;
+      res = tmp;
+    }
+  else
+    {
+      res = kissat_dereference_clause (solver, watch.large.ref);
+      if (res->garbage)
+	return 0;
+      for (all_literals_in_clause (other, res))
+	if (values[other] > 0)
+	  return 0;
+    }
+  return res;
+}
+
+// A candidate is deferred to a later batch if its neighborhood overlaps
+// with one of an already scheduled candidate.  If it has too many
+// occurrences or too long clauses it is left to the sequential loop,
+// which then fails quickly.
+
+static bool
+schedule_candidate (kissat * solver, scheduler * scheduler, unsigned idx)
+{
+  bool *const touched = scheduler->touched;
+  if (touched[idx])
+    return false;
+  const unsigned clslim = GET_OPTION (eliminateclslim);
+  const unsigned occlim = GET_OPTION (eliminateocclim);
+  const unsigned lit = LIT (idx);
+  unsigned occurrences[2] = { 0, 0 };
+  clause tmp;
+  memset (&tmp, 0, sizeof tmp);
+  tmp.size = 2;
+  for (unsigned sign = 0; sign < 2; sign++)
+    {
+      const unsigned pivot = lit ^ sign;
+      for (all_binary_large_watches (watch, WATCHES (pivot)))
+	{
+	  clause *c = watch_to_clause (solver, &tmp, pivot, watch);
+	  if (!c)
+	    continue;
+	  if (c->size > clslim)
+	    {
+	      scheduler->tried[idx] = true;
+	      return false;
+	    }
+	  for (all_literals_in_clause (other, c))
+	    if (touched[IDX (other)])
+	      return false;
+	  occurrences[sign]++;
+	}
+    }
+  const unsigned sum = occurrences[0] + occurrences[1];
+  scheduler->tried[idx] = true;
+  if (occurrences[0] && occurrences[1] && sum > occlim)
+    return false;
+  unsigneds *const neighbors = &scheduler->neighbors;
+  touched[idx] = true;
+  PUSH_STACK (*neighbors, idx);
+  for (unsigned sign = 0; sign < 2; sign++)
+    {
+      const unsigned pivot = lit ^ sign;
+      for (all_binary_large_watches (watch, WATCHES (pivot)))
+	{
+	  clause *c = watch_to_clause (solver, &tmp, pivot, watch);
+	  if (!c)
+	    continue;
+	  for (all_literals_in_clause (other, c))
+	    {
+	      const unsigned other_idx = IDX (other);
+	      if (touched[other_idx])
+		continue;
+	      touched[other_idx] = true;
+	      PUSH_STACK (*neighbors, other_idx);
+	    }
+	}
+    }
+  candidate candidate;
+  memset (&candidate, 0, sizeof candidate);
+  candidate.lit = occurrences[0] > occurrences[1] ? NOT (lit) : lit;
+  candidate.occurrences = sum;
+  PUSH_STACK (scheduler->candidates, candidate);
+  return true;
+}
+
+static unsigned
+schedule_candidates (kissat * solver, scheduler * scheduler)
+{
+  assert (EMPTY_STACK (scheduler->candidates));
+  const flags *const all_flags = solver->flags;
+  for (unsigned idx = 0; idx != solver->vars; idx++)
+    {
+      const flags *const flags = all_flags + idx;
+      if (!flags->active || !flags->eliminate || scheduler->tried[idx])
+	continue;
+      schedule_candidate (solver, scheduler, idx);
+    }
+  for (all_stack (unsigned, idx, scheduler->neighbors))
+    scheduler->touched[idx] = false;
+  CLEAR_STACK (scheduler->neighbors);
+  return SIZE_STACK (scheduler->candidates);
+}
+
+/*------------------------------------------------------------------------*/
+
+// Same as 'generate_resolvents' in 'resolve.c' without gates, except that
+// satisfied clauses are skipped instead of being marked as garbage and
+// that unit or empty resolvents make the candidate fail.
+
+static void
+resolve_candidate (kissat * solver, resolver * resolver,
+		   candidate * candidate)
+{
+  const unsigned lit = candidate->lit;
+  const unsigned not_lit = NOT (lit);
+  const unsigned clslim = GET_OPTION (eliminateclslim);
+  const uint64_t limit = candidate->occurrences +
+    (uint64_t) solver->bounds.eliminate.additional_clauses;
+  const value *const values = solver->values;
+  value *const marks = resolver->marks;
+
+  clause tmp0, tmp1;
+  memset (&tmp0, 0, sizeof tmp0);
+  memset (&tmp1, 0, sizeof tmp1);
+  tmp0.size = tmp1.size = 2;
+
+  candidate->begin = resolver->resolvents.size;
+  uint64_t resolved = 0;
+  bool failed = false;
+
+  for (all_binary_large_watches (watch0, WATCHES (lit)))
+    {
+      clause *const c = watch_to_clause (solver, &tmp0, lit, watch0);
+      if (!c)
+	continue;
+
+      for (all_literals_in_clause (other, c))
+	if (other != lit && !values[other])
+	  marks[other] = 1;
+
+      for (all_binary_large_watches (watch1, WATCHES (not_lit)))
+	{
+	  clause *const d = watch_to_clause (solver, &tmp1, not_lit, watch1);
+	  if (!d)
+	    continue;
+
+	  resolver->resolutions++;
+
+	  const size_t saved = resolver->resolvents.size;
+	  bool tautological = false;
+
+	  for (all_literals_in_clause (other, d))
+	    {
+	      if (other == not_lit || values[other] || marks[other])
+		continue;
+	      if (marks[NOT (other)])
+		{
+		  tautological = true;
+		  break;
+		}
+	      PUSH_BUFFER (resolver->resolvents, other);
+	    }
+
+	  if (tautological)
+	    {
+	      resolver->resolvents.size = saved;
+	      continue;
+	    }
+
+	  if (++resolved > limit)
+	    {
+	      failed = true;
+	      break;
+	    }
+
+	  for (all_literals_in_clause (other, c))
+	    if (other != lit && !values[other])
+	      PUSH_BUFFER (resolver->resolvents, other);
+
+	  const size_t size = resolver->resolvents.size - saved;
+	  if (size < 2 || size > clslim)
+	    {
+	      failed = true;
+	      break;
+	    }
+
+	  PUSH_BUFFER (resolver->resolvents, INVALID_LIT);
+	}
+
+      for (all_literals_in_clause (other, c))
+	marks[other] = 0;
+
+      if (failed)
+	break;
+    }
+
+  if (failed)
+    resolver->resolvents.size = candidate->begin;
+  candidate->end = resolver->resolvents.size;
+  candidate->eliminate = !failed;
+}
+
+static void *
+resolve_candidates (void *ptr)
+{
+  resolver *resolver = ptr;
+  scheduler *scheduler = resolver->scheduler;
+  kissat *solver = scheduler->solver;
+  const unsigned id = resolver - scheduler->resolvers;
+  candidate *const candidates = BEGIN_STACK (scheduler->candidates);
+  const size_t size = SIZE_STACK (scheduler->candidates);
+  for (;;)
+    {
+      const unsigned i = atomic_fetch_add (&scheduler->next, 1);
+      if (i >= size)
+	break;
+      candidate *candidate = candidates + i;
+      candidate->resolver = id;
+      resolve_candidate (solver, resolver, candidate);
+    }
+  return 0;
+}
+
+// The main thread acts as the first resolver.
+
+static void
+resolve_in_parallel (kissat * solver, scheduler * scheduler)
+{
+  const unsigned size = scheduler->size;
+  resolver *const resolvers = scheduler->resolvers;
+  for (unsigned i = 0; i < size; i++)
+    resolvers[i].resolvents.size = 0;
+  atomic_init (&scheduler->next, 0);
+  for (unsigned i = 1; i < size; i++)
+    if (pthread_create (&resolvers[i].thread, 0,
+			resolve_candidates, resolvers + i))
+      kissat_fatal ("failed to create resolver thread %u", i);
+  resolve_candidates (resolvers);
+  for (unsigned i = 1; i < size; i++)
+    if (pthread_join (resolvers[i].thread, 0))
+      kissat_fatal ("failed to join resolver thread %u", i);
+  uint64_t resolutions = 0;
+  for (unsigned i = 0; i < size; i++)
+    {
+      resolutions += resolvers[i].resolutions;
+      resolvers[i].resolutions = 0;
+    }
+  ADD (eliminate_resolutions, resolutions);
+}
+
+// Eliminating a candidate never assigns variables since unit resolvents
+// make it fail.  Still, if the trail grows anyhow, the remaining
+// candidates are left to the sequential loop.
+
+static unsigned
+commit_candidates (kissat * solver, scheduler * scheduler)
+{
+  const size_t trail = SIZE_ARRAY (solver->trail);
+  unsigned eliminated = 0;
+  for (all_stack (candidate, candidate, scheduler->candidates))
+    {
+      if (solver->inconsistent)
+	break;
+      if (SIZE_ARRAY (solver->trail) != trail)
+	break;
+      if (!candidate.eliminate)
+	continue;
+      const unsigned idx = IDX (candidate.lit);
+      LOG ("committing parallel elimination of %s", LOGVAR (idx));
+      FLAGS (idx)->eliminate = false;
+      const resolver *const resolver =
+	scheduler->resolvers + candidate.resolver;
+      assert (EMPTY_STACK (solver->resolvents));
+      const unsigned *const end = resolver->resolvents.begin + candidate.end;
+      for (const unsigned *p = resolver->resolvents.begin + candidate.begin;
+	   p != end; p++)
+	PUSH_STACK (solver->resolvents, *p);
+      kissat_eliminate_resolved_variable (solver, candidate.lit);
+      eliminated++;
+    }
+  CLEAR_STACK (scheduler->candidates);
+  return eliminated;
+}
+
+unsigned
+kissat_eliminate_variables_in_parallel (kissat * solver,
+					uint64_t resolution_limit,
+					uint64_t * tried)
+{
+  assert (!solver->inconsistent);
+  assert (!solver->watching);
+  scheduler scheduler;
+  init_scheduler (solver, &scheduler);
+  const unsigned threads = scheduler.size;
+  unsigned eliminated = 0, batches = 0;
+  while (!solver->inconsistent)
+    {
+      if (TERMINATED (eliminate_terminated_1))
+	break;
+      if (solver->statistics.eliminate_resolutions > resolution_limit)
+	break;
+      const unsigned scheduled = schedule_candidates (solver, &scheduler);
+      if (scheduled < 2 * threads)
+	{
+	  CLEAR_STACK (scheduler.candidates);
+	  break;
+	}
+      batches++;
+      *tried += scheduled;
+      ADD (eliminate_attempted, scheduled);
+      resolve_in_parallel (solver, &scheduler);
+      const unsigned committed = commit_candidates (solver, &scheduler);
+      kissat_extremely_verbose (solver, "parallel elimination batch %u "
+				"eliminated %u of %u scheduled candidates",
+				batches, committed, scheduled);
+      eliminated += committed;
+    }
+  release_scheduler (solver, &scheduler);
+  kissat_very_verbose (solver, "eliminated %u variables in %u batches "
+		       "resolved by %u threads", eliminated, batches,
+		       threads);
+  return eliminated;
+}
@@ -0,0 +1,24 @@
+#ifndef _elimination_h_INCLUDED
+#define _elimination_h_INCLUDED
+
+#include <stdint.h>
+
+struct kissat;
+
+// Bounded variable elimination with several threads.  Candidates are
+// scheduled in batches of variables with disjoint neighborhoods, i.e., no
+// variable occurs in the clauses of two scheduled candidates.  The
+// resolvents of all candidates of a batch are then generated in parallel
+// by resolver threads, which only read the (connected) clauses and use
+// their own marks.  Finally the main thread commits successful candidates
+// one after the other in variable order through the same code as
+// sequential elimination, which thus also keeps the extension stack
+// consistent.  Only plain resolution is tried in parallel.  Candidates
+// which fail, would produce units or were not scheduled stay flagged and
+// are tried again (with gate extraction) by the sequential loop.
+
+unsigned kissat_eliminate_variables_in_parallel (struct kissat *,
+						 uint64_t resolution_limit,
+						 uint64_t *tried);
+
+#endif
@@ -0,0 +1,214 @@
+#include "portfolio.h"
+#include "covering.h"
+#include "cube.h"
+
+#include "error.h"
+#include "internal.h"
+#include "print.h"
+
+#include <mpi.h>
+#include <string.h>
+
+// Message tag used to announce a result to the other ranks.
+
+#define RESULT_TAG 1
+
+// Testing for incoming messages is not free, so we only do it every that
+// many calls to 'kissat_poll_portfolio' (which happens once per iteration
+// of the main CDCL loop).
+
+#define POLL_INTERVAL 256
+
+static struct
+{
+  bool enabled;
+  bool cubing;
+  int rank;
+  int size;
+  unsigned polled;
+  kissat *solver;
+  int received;
+  int announced;
+  MPI_Request receive;
+} portfolio = {.size = 1 };
+
+bool
+kissat_init_portfolio (int *argc_ptr, char ***argv_ptr)
+{
+  const int argc = *argc_ptr;
+  char **argv = *argv_ptr;
+  int j = 1;
+  for (int i = 1; i < argc; i++)
+    if (!strcmp (argv[i], "--portfolio"))
+      portfolio.enabled = true;
+    else if (!strcmp (argv[i], "--cube"))
+      portfolio.enabled = portfolio.cubing = true;
+    else
+      argv[j++] = argv[i];
+  argv[j] = 0;
+  *argc_ptr = j;
+  if (!portfolio.enabled)
+    return false;
+  int provided;
+  MPI_Init_thread (argc_ptr, argv_ptr, MPI_THREAD_FUNNELED, &provided);
+  if (provided < MPI_THREAD_FUNNELED)
+    kissat_fatal ("MPI library does not support threads");
+  MPI_Comm_rank (MPI_COMM_WORLD, &portfolio.rank);
+  MPI_Comm_size (MPI_COMM_WORLD, &portfolio.size);
+  // Without workers the coordinator would wait forever for the results of
+  // its cubes, thus a single rank falls back to plain solving.
+  if (portfolio.size < 2)
+    portfolio.cubing = false;
+  MPI_Irecv (&portfolio.announced, 1, MPI_INT, MPI_ANY_SOURCE,
+	     RESULT_TAG, MPI_COMM_WORLD, &portfolio.receive);
+  return true;
+}
+
+// Solvers are diversified through a covering array of option values (see
+// 'covering.h').  Since every solver also uses its index as random seed,
+// solvers with the same options still differ.
+
+void
+kissat_configure_solver (kissat * solver, unsigned id, unsigned size)
+{
+  kissat_set_option (solver, "seed", id);
+  kissat_configure_covering (solver, id, size);
+  if (id)
+    kissat_set_option (solver, "quiet", 1);
+}
+
+void
+kissat_configure_portfolio (kissat * solver)
+{
+  if (!portfolio.enabled)
+    return;
+  kissat_configure_solver (solver, portfolio.rank, portfolio.size);
+  portfolio.solver = solver;
+}
+
+// With threads (see 'threads.h') only the main solver of a rank polls, as
+// all MPI calls have to be made by the main thread.  It then stops the
+// other threads after being terminated.
+
+void
+kissat_poll_portfolio (kissat * solver)
+{
+  if (!portfolio.enabled)
+    return;
+  if (solver != portfolio.solver)
+    return;
+  if (++portfolio.polled % POLL_INTERVAL)
+    return;
+  kissat_poll_cube (solver);
+  if (portfolio.receive == MPI_REQUEST_NULL)
+    return;
+  int flag;
+  MPI_Test (&portfolio.receive, &flag, MPI_STATUS_IGNORE);
+  if (!flag)
+    return;
+  portfolio.received++;
+  kissat_verbose (solver, "other rank announced result %d",
+		  portfolio.announced);
+  kissat_terminate (solver);
+}
+
+// Several ranks might find a result at the same time and each of them has
+// sent an announcement to all the others.  Thus we first agree on how many
+// announcements are in flight and then receive all of them, since leaving
+// unmatched messages behind is erroneous with respect to 'MPI_Finalize'.
+
+static void
+drain_announcements (int expected)
+{
+  if (portfolio.receive != MPI_REQUEST_NULL)
+    {
+      if (portfolio.received < expected)
+	{
+	  MPI_Wait (&portfolio.receive, MPI_STATUS_IGNORE);
+	  portfolio.received++;
+	}
+      else
+	{
+	  MPI_Cancel (&portfolio.receive);
+	  MPI_Wait (&portfolio.receive, MPI_STATUS_IGNORE);
+	}
+    }
+  while (portfolio.received < expected)
+    {
+      MPI_Recv (&portfolio.announced, 1, MPI_INT, MPI_ANY_SOURCE,
+		RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      portfolio.received++;
+    }
+}
+
+// The lowest rank with a result wins.  Only the winner prints the result
+// and the witness, or rank zero if no rank found a result within limits.
+
+int
+kissat_finish_portfolio (kissat * solver, int res, bool *print)
+{
+  *print = true;
+  if (!portfolio.enabled)
+    return res;
+  const int rank = portfolio.rank;
+  const int size = portfolio.size;
+  const int others = size - 1;
+  MPI_Request *sends = 0;
+  if (res && others)
+    {
+      sends = malloc (others * sizeof *sends);
+      if (!sends)
+	kissat_fatal ("out-of-memory allocating announcements");
+      for (int other = 0, i = 0; other < size; other++)
+	if (other != rank)
+	  MPI_Isend (&res, 1, MPI_INT, other, RESULT_TAG,
+		     MPI_COMM_WORLD, sends + i++);
+    }
+  const int finished = (res != 0);
+  int finishers;
+  MPI_Allreduce (&finished, &finishers, 1, MPI_INT,
+		 MPI_SUM, MPI_COMM_WORLD);
+  const int candidate = res ? rank : size;
+  int winner;
+  MPI_Allreduce (&candidate, &winner, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  drain_announcements (finishers - finished);
+  if (sends)
+    {
+      MPI_Waitall (others, sends, MPI_STATUSES_IGNORE);
+      free (sends);
+    }
+  int agreed = 0;
+  if (winner < size)
+    {
+      agreed = res;
+      MPI_Bcast (&agreed, 1, MPI_INT, winner, MPI_COMM_WORLD);
+    }
+  *print = (winner < size) ? (rank == winner) : !rank;
+  kissat_verbose (solver, "rank %d won with result %d", winner, agreed);
+  return agreed;
+}
+
+void
+kissat_release_portfolio (void)
+{
+  if (portfolio.enabled)
+    MPI_Finalize ();
+}
+
+bool
+kissat_portfolio_cubing (void)
+{
+  return portfolio.cubing;
+}
+
+int
+kissat_portfolio_rank (void)
+{
+  return portfolio.rank;
+}
+
+int
+kissat_portfolio_size (void)
+{
+  return portfolio.size;
+}
@@ -0,0 +1,27 @@
+#ifndef _portfolio_h_INCLUDED
+#define _portfolio_h_INCLUDED
+
+#include <stdbool.h>
+
+struct kissat;
+
+// Running 'mpirun -np N ssat --portfolio ...' starts 'N' ranks each with
+// its own differently configured solver on the same formula.  The first
+// rank finding a result tells all the others, which then stop through the
+// usual 'TERMINATED' checks.  Without '--portfolio' all of these functions
+// are no-ops and 'ssat' behaves as a single sequential solver.  The option
+// '--cube' starts ranks in cube-and-conquer mode instead (see 'cube.h'),
+// which needs at least two ranks (a single rank just solves the formula).
+
+bool kissat_init_portfolio (int *argc_ptr, char ***argv_ptr);
+void kissat_configure_portfolio (struct kissat *);
+void kissat_configure_solver (struct kissat *, unsigned id, unsigned size);
+void kissat_poll_portfolio (struct kissat *);
+int kissat_finish_portfolio (struct kissat *, int res, bool *print);
+void kissat_release_portfolio (void);
+
+bool kissat_portfolio_cubing (void);
+int kissat_portfolio_rank (void);
+int kissat_portfolio_size (void);
+
+#endif
@@ -0,0 +1,95 @@
+#include "ring.h"
+
+#include "allocate.h"
+
+#include <assert.h>
+
+ring *
+kissat_new_ring (struct kissat *solver, unsigned ld_size, unsigned consumers)
+{
+  ring *ring = kissat_calloc (solver, 1, sizeof *ring);
+  const uint64_t size = (uint64_t) 1 << ld_size;
+  ring->mask = size - 1;
+  ring->consumers = consumers;
+  ring->tails = kissat_calloc (solver, consumers, sizeof (uint64_t));
+  ring->data = kissat_calloc (solver, size, sizeof *ring->data);
+  atomic_init (&ring->head, 0);
+  atomic_init (&ring->reserved, 0);
+  return ring;
+}
+
+void
+kissat_release_ring (struct kissat *solver, ring * ring)
+{
+  const uint64_t size = ring->mask + 1;
+  kissat_dealloc (solver, ring->data, size, sizeof *ring->data);
+  kissat_dealloc (solver, ring->tails, ring->consumers, sizeof (uint64_t));
+  kissat_free (solver, ring, sizeof *ring);
+}
+
+void
+kissat_publish_ring (ring * ring, size_t size, const int *data)
+{
+  const uint64_t mask = ring->mask;
+  if (size > mask)
+    return;
+  const uint64_t head =
+    atomic_load_explicit (&ring->head, memory_order_relaxed);
+  const uint64_t end = head + size + 1;
+  atomic_store_explicit (&ring->reserved, end, memory_order_relaxed);
+  atomic_thread_fence (memory_order_release);
+  _Atomic (int) *const slots = ring->data;
+  atomic_store_explicit (slots + (head & mask), (int) size,
+			 memory_order_relaxed);
+  for (size_t i = 0; i < size; i++)
+    atomic_store_explicit (slots + ((head + 1 + i) & mask), data[i],
+			   memory_order_relaxed);
+  atomic_store_explicit (&ring->head, end, memory_order_release);
+}
+
+// Copies the next batch and then checks that the producer has not started
+// to overwrite it in the meantime.  If it did, or if the consumer was lapped
+// by the producer before, the positions of the remaining batches are lost
+// and the consumer simply continues with the next batch published.
+
+bool
+kissat_consume_ring (struct kissat *solver, ring * ring, unsigned consumer,
+		     ints * batch, uint64_t * lost)
+{
+  assert (consumer < ring->consumers);
+  uint64_t *const tail_ptr = ring->tails + consumer;
+  const uint64_t tail = *tail_ptr;
+  const uint64_t head =
+    atomic_load_explicit (&ring->head, memory_order_acquire);
+  if (tail == head)
+    return false;
+  const uint64_t mask = ring->mask;
+  const uint64_t capacity = mask + 1;
+  _Atomic (int) *const slots = ring->data;
+  CLEAR_STACK (*batch);
+  bool valid = (head - tail <= capacity);
+  uint64_t end = tail;
+  if (valid)
+    {
+      const int size =
+	atomic_load_explicit (slots + (tail & mask), memory_order_relaxed);
+      end = tail + 1 + (uint64_t) size;
+      valid = (size >= 0 && end <= head);
+      for (uint64_t pos = tail + 1; valid && pos != end; pos++)
+	PUSH_STACK (*batch, atomic_load_explicit (slots + (pos & mask),
+						  memory_order_relaxed));
+      atomic_thread_fence (memory_order_acquire);
+      const uint64_t reserved =
+	atomic_load_explicit (&ring->reserved, memory_order_relaxed);
+      valid = valid && (reserved - tail <= capacity);
+    }
+  if (valid)
+    {
+      *tail_ptr = end;
+      return true;
+    }
+  CLEAR_STACK (*batch);
+  *tail_ptr = atomic_load_explicit (&ring->head, memory_order_acquire);
+  (*lost)++;
+  return false;
+}
@@ -0,0 +1,43 @@
+#ifndef _ring_h_INCLUDED
+#define _ring_h_INCLUDED
+
+#include "stack.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free single-producer / multi-consumer ring buffer of integers used
+// to share clause batches between solver threads.  Every thread owns one
+// ring and is its only producer, while all other threads consume from it
+// with their own private read position.  The producer never waits.  A
+// consumer which falls behind by more than the capacity of the ring loses
+// the overwritten batches, which for clause sharing is fine.
+//
+// Each batch is stored as its size followed by its integers.  To detect
+// batches overwritten while being copied the producer first announces how
+// far it is going to write ('reserved'), then writes and finally publishes
+// the batch by moving 'head' (the same protocol as a sequence lock).
+
+typedef struct ring ring;
+
+struct ring
+{
+  _Atomic (uint64_t) head;
+  _Atomic (uint64_t) reserved;
+  uint64_t mask;
+  unsigned consumers;
+  uint64_t *tails;
+  _Atomic (int) *data;
+};
+
+struct kissat;
+
+ring *kissat_new_ring (struct kissat *, unsigned ld_size, unsigned consumers);
+void kissat_release_ring (struct kissat *, ring *);
+
+void kissat_publish_ring (ring *, size_t size, const int *data);
+bool kissat_consume_ring (struct kissat *, ring *, unsigned consumer,
+			  ints * batch, uint64_t * lost);
+
+#endif
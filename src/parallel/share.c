@@ -0,0 +1,824 @@
+#include "share.h"
+#include "barrier.h"
+#include "codec.h"
+#include "cube.h"
+#include "portfolio.h"
+#include "ring.h"
+
+#include "../file_utils/fragment.h"
+
+#include "allocate.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+#include "proof.h"
+
+#include <inttypes.h>
+#include <mpi.h>
+#include <string.h>
+
+// Message tag of clause batches (announcements use tag one).
+
+#define CLAUSES_TAG 2
+
+// Size of the direct mapped table of clause hashes used to filter clauses
+// which were exported or imported before.  Collisions simply overwrite
+// older entries, thus the filter might miss duplicates but never drops a
+// clause which was not seen before (up to hash collisions).
+
+#define LD_SIZE_FILTER 18
+#define SIZE_FILTER ((size_t) 1 << LD_SIZE_FILTER)
+
+// Clauses are shared on up to three levels: with the other threads of the
+// process through rings, with the other ranks on the same node and (only
+// by the node leaders) with the leaders of the other nodes.  Clauses
+// received on one level are relayed to the other levels.
+
+enum level
+{
+  RING_LEVEL,
+  NODE_LEVEL,
+  NODES_LEVEL,
+  LEVELS,
+};
+
+typedef struct channel channel;
+typedef struct share share;
+
+struct channel
+{
+  bool enabled;
+  ints batch;			// Batch of 'glue lits... 0' to be sent.
+  chars sending;		// Encoded batch currently in flight.
+  int pending;			// Number of in flight sends.
+  MPI_Request *requests;	// Requests of in flight sends.
+};
+
+struct share
+{
+  ints exported;		// Learned 'glue lits... 0' to be distributed.
+  channel channels[LEVELS];
+  chars bytes;			// Encoded batch just received.
+  ints received;		// Batch just received.
+  int *leaders;			// Node leader of each rank.
+  int *sent_to;			// Number of batches sent per rank.
+  int *received_from;		// Number of batches received per rank.
+  unsigned shared;		// Calls to 'kissat_share_clauses'.
+  ring **rings;			// Rings of all threads (or zero).
+  unsigned thread;		// Index of our own ring.
+  unsigned threads;		// Number of rings.
+  barrier *barrier;		// Synchronizing threads (or zero).
+  uint64_t synchronize;		// Search ticks of next barrier.
+  uint64_t *filter;		// Hashes of clauses seen.
+  struct
+  {
+    uint64_t batches;
+    uint64_t decoded;
+    uint64_t dropped;
+    uint64_t duplicated;
+    uint64_t encoded;
+    uint64_t exported;
+    uint64_t ignored;
+    uint64_t imported;
+    uint64_t lost;
+    uint64_t received;
+    uint64_t relayed;
+    uint64_t sent;
+    uint64_t synchronized;
+  } statistics;
+};
+
+static uint64_t
+sync_interval (kissat * solver)
+{
+  return 1000 * (uint64_t) GET_OPTION (sharesync);
+}
+
+static share *
+new_share (kissat * solver)
+{
+  assert (!solver->share);
+  if (!GET_OPTION (share))
+    return 0;
+  if (kissat_checking (solver) ||
+      (kissat_proving (solver) && !kissat_fragments ()))
+    {
+      kissat_message (solver, "clause sharing disabled "
+		      "(imported clauses can not be checked)");
+      return 0;
+    }
+  share *share = kissat_calloc (solver, 1, sizeof *share);
+  share->filter = kissat_calloc (solver, SIZE_FILTER, sizeof (uint64_t));
+  solver->share = share;
+  return share;
+}
+
+// The ranks sharing memory form a node and the one with the smallest rank
+// is its leader.  Without '--sharenodes' (and in cube-and-conquer mode)
+// all ranks are considered to be on the same node and clauses are sent
+// from all ranks to all ranks.  This is collective.  Leaders aggregate the
+// clauses of their node and send them to the other leaders only at every
+// '--sharenodes' restart.
+
+static void
+find_node_leaders (kissat * solver, int *leaders)
+{
+  const int size = kissat_portfolio_size ();
+  if (!GET_OPTION (sharenodes) || kissat_portfolio_cubing ())
+    {
+      memset (leaders, 0, size * sizeof *leaders);
+      return;
+    }
+  int leader = kissat_portfolio_rank ();
+  MPI_Comm node;
+  MPI_Comm_split_type (MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, leader,
+		       MPI_INFO_NULL, &node);
+  MPI_Bcast (&leader, 1, MPI_INT, 0, node);
+  MPI_Comm_free (&node);
+  MPI_Allgather (&leader, 1, MPI_INT, leaders, 1, MPI_INT, MPI_COMM_WORLD);
+  unsigned nodes = 0;
+  for (int other = 0; other < size; other++)
+    nodes += (leaders[other] == other);
+  kissat_very_verbose (solver, "%d ranks on %u nodes", size, nodes);
+}
+
+void
+kissat_init_share (kissat * solver)
+{
+  const int size = kissat_portfolio_size ();
+  if (size == 1)
+    return;
+  int *leaders = kissat_nalloc (solver, size, sizeof (int));
+  find_node_leaders (solver, leaders);
+  share *share = new_share (solver);
+  if (!share)
+    {
+      kissat_dealloc (solver, leaders, size, sizeof (int));
+      return;
+    }
+  if (GET_OPTION (sharesync))
+    kissat_warning (solver, "ignoring '--sharesync' "
+		    "(deterministic sharing requires threads)");
+  share->leaders = leaders;
+  share->sent_to = kissat_calloc (solver, size, sizeof (int));
+  share->received_from = kissat_calloc (solver, size, sizeof (int));
+  const int rank = kissat_portfolio_rank ();
+  channel *node = share->channels + NODE_LEVEL;
+  node->enabled = true;
+  node->requests = kissat_nalloc (solver, size, sizeof (MPI_Request));
+  bool other_nodes = false;
+  for (int other = 0; !other_nodes && other < size; other++)
+    other_nodes = (leaders[other] != leaders[rank]);
+  if (leaders[rank] == rank && other_nodes)
+    {
+      channel *nodes = share->channels + NODES_LEVEL;
+      nodes->enabled = true;
+      nodes->requests = kissat_nalloc (solver, size, sizeof (MPI_Request));
+    }
+}
+
+// With threads and ranks the main thread additionally shares clauses
+// through the rings with the other threads of its process (thus only the
+// main thread calls MPI).  The barriers of the deterministic mode are only
+// used without ranks.
+
+void
+kissat_init_ring_share (kissat * solver, unsigned thread, unsigned threads,
+			ring ** rings, barrier * barrier)
+{
+  assert (thread < threads);
+  share *share = solver->share;
+  if (!share)
+    share = new_share (solver);
+  if (!share)
+    return;
+  share->channels[RING_LEVEL].enabled = true;
+  share->rings = rings;
+  share->thread = thread;
+  share->threads = threads;
+  if (!barrier || share->leaders)
+    return;
+  share->barrier = barrier;
+  share->synchronize = sync_interval (solver);
+}
+
+/*------------------------------------------------------------------------*/
+
+// Hashing requires the external literals to be sorted, which for the short
+// clauses we export is fastest with insertion sort.  They are sorted by
+// their DRAT encoding, as batches sent to other ranks are delta encoded.
+
+static unsigned
+external_literal_key (int elit)
+{
+  return 2u * ABS (elit) + (elit < 0);
+}
+
+static void
+sort_external_literals (size_t size, int *elits)
+{
+  for (size_t i = 1; i < size; i++)
+    {
+      const int elit = elits[i];
+      const unsigned key = external_literal_key (elit);
+      size_t j = i;
+      while (j && external_literal_key (elits[j - 1]) > key)
+	elits[j] = elits[j - 1], j--;
+      elits[j] = elit;
+    }
+}
+
+static uint64_t
+hash_external_literals (size_t size, const int *elits)
+{
+  uint64_t res = size;
+  for (size_t i = 0; i < size; i++)
+    {
+      res += (unsigned) elits[i];
+      res *= 0x9e3779b97f4a7c15ull;
+      res ^= res >> 29;
+    }
+  return res ? res : 1;
+}
+
+// Returns 'true' if the hash was already in the filter and otherwise adds
+// it to the filter.
+
+static bool
+filtered (share * share, uint64_t hash)
+{
+  uint64_t *const entry = share->filter + (hash & (SIZE_FILTER - 1));
+  if (*entry == hash)
+    return true;
+  *entry = hash;
+  return false;
+}
+
+static unsigned
+export_glue_limit (kissat * solver)
+{
+  const int tier = GET_OPTION (sharetier);
+  if (tier == 2)
+    return GET_OPTION (tier2);
+  if (tier == 1)
+    return GET_OPTION (tier1);
+  return 0;
+}
+
+void
+kissat_export_learned_clause (kissat * solver, unsigned glue)
+{
+  share *share = solver->share;
+  if (!share)
+    return;
+  const size_t size = SIZE_STACK (solver->clause);
+  if (size > 2 && glue > export_glue_limit (solver))
+    return;
+  if (size > (size_t) GET_OPTION (sharesize))
+    return;
+  if (SIZE_STACK (share->exported) >= (size_t) GET_OPTION (sharebatch))
+    {
+      share->statistics.dropped++;
+      return;
+    }
+  ints *exported = &share->exported;
+  PUSH_STACK (*exported, (int) glue);
+  const size_t offset = SIZE_STACK (*exported);
+  for (all_stack (unsigned, ilit, solver->clause))
+    {
+      const int elit = kissat_export_literal (solver, ilit);
+      assert (elit);
+      PUSH_STACK (*exported, elit);
+    }
+  int *elits = BEGIN_STACK (*exported) + offset;
+  sort_external_literals (size, elits);
+  if (filtered (share, hash_external_literals (size, elits)))
+    {
+      RESIZE_STACK (*exported, offset - 1);
+      share->statistics.duplicated++;
+      return;
+    }
+  PUSH_STACK (*exported, 0);
+  share->statistics.exported++;
+}
+
+/*------------------------------------------------------------------------*/
+
+static unsigned
+import_shared_literal (kissat * solver, int elit)
+{
+  const unsigned eidx = ABS (elit);
+  if (eidx >= SIZE_STACK (solver->import))
+    return INVALID_LIT;
+  const import *const import = &PEEK_STACK (solver->import, eidx);
+  if (!import->imported || import->eliminated)
+    return INVALID_LIT;
+  unsigned ilit = import->lit;
+  if (!ACTIVE (IDX (ilit)) && !VALUE (ilit))
+    return INVALID_LIT;
+  if (elit < 0)
+    ilit = NOT (ilit);
+  return ilit;
+}
+
+// Literals of imported clauses are mapped back to internal literals which
+// after substitution might yield duplicated literals or tautologies, while
+// root-level falsified literals are removed.  Clauses with literals this
+// rank does not have (anymore) or root-level satisfied clauses are ignored.
+
+bool
+kissat_import_external_literals (kissat * solver,
+				 size_t size, const int *elits)
+{
+  assert (EMPTY_STACK (solver->clause));
+  bool ignore = false;
+  for (size_t i = 0; !ignore && i < size; i++)
+    {
+      const unsigned ilit = import_shared_literal (solver, elits[i]);
+      if (ilit == INVALID_LIT)
+	ignore = true;
+      else if (MARK (ilit) > 0)
+	continue;
+      else if (MARK (ilit) < 0)
+	ignore = true;
+      else
+	{
+	  const value value = VALUE (ilit);
+	  if (value > 0)
+	    ignore = true;
+	  else if (!value)
+	    {
+	      MARK (ilit) = 1;
+	      MARK (NOT (ilit)) = -1;
+	      PUSH_STACK (solver->clause, ilit);
+	    }
+	}
+    }
+  for (all_stack (unsigned, lit, solver->clause))
+      MARK (lit) = MARK (NOT (lit)) = 0;
+  if (ignore)
+    CLEAR_STACK (solver->clause);
+  return !ignore;
+}
+
+// Also used to import units and equivalences (see 'window.h'), which
+// is why the glue is passed in and failure is reported.
+
+bool
+kissat_import_external_clause (kissat * solver, unsigned glue,
+			       size_t size, const int *elits)
+{
+  if (!kissat_import_external_literals (solver, size, elits))
+    return false;
+  const size_t isize = SIZE_STACK (solver->clause);
+  unsigned *const ilits = BEGIN_STACK (solver->clause);
+  if (!isize)
+    {
+      LOG ("imported empty clause");
+      solver->inconsistent = true;
+    }
+  else if (isize == 1)
+    {
+      LOG ("imported unit %s", LOGLIT (ilits[0]));
+      kissat_learned_unit (solver, ilits[0]);
+    }
+  else if (isize == 2)
+    kissat_new_binary_clause (solver, true, ilits[0], ilits[1]);
+  else
+    {
+      const reference ref = kissat_new_redundant_clause (solver, glue);
+      clause *const c = kissat_dereference_clause (solver, ref);
+      c->used = 1 + (glue <= (unsigned) GET_OPTION (tier2));
+    }
+  CLEAR_STACK (solver->clause);
+  return true;
+}
+
+// Batches are sent at every restart, except for the nodes level, which
+// collects clauses for '--sharenodes' restarts and thus gets a limit that
+// many times larger than '--sharebatch'.
+
+static size_t
+batch_limit (kissat * solver, enum level level)
+{
+  const size_t limit = GET_OPTION (sharebatch);
+  if (level != NODES_LEVEL)
+    return limit;
+  const unsigned interval = GET_OPTION (sharenodes);
+  return interval ? limit * interval : limit;
+}
+
+// Adds the clause to the batches of all levels except the one it came
+// from (exported clauses come from 'LEVELS').  Batches which are not sent
+// (because the previous one is still in flight) only grow up to the limit
+// of their level.
+
+static void
+relay_clause (kissat * solver, share * share, enum level from,
+	      unsigned glue, size_t size, const int *elits)
+{
+  for (unsigned level = 0; level < LEVELS; level++)
+    {
+      channel *const channel = share->channels + level;
+      if (level == from || !channel->enabled)
+	continue;
+      ints *const batch = &channel->batch;
+      if (SIZE_STACK (*batch) >= batch_limit (solver, level))
+	{
+	  share->statistics.dropped++;
+	  continue;
+	}
+      PUSH_STACK (*batch, (int) glue);
+      for (size_t i = 0; i < size; i++)
+	PUSH_STACK (*batch, elits[i]);
+      PUSH_STACK (*batch, 0);
+      if (from != LEVELS)
+	share->statistics.relayed++;
+    }
+}
+
+static void
+relay_batch (kissat * solver, share * share, enum level from,
+	     const ints * batch)
+{
+  const int *p = BEGIN_STACK (*batch);
+  const int *const end = END_STACK (*batch);
+  while (p != end)
+    {
+      const unsigned glue = *p++;
+      const int *const elits = p;
+      while (*p)
+	p++;
+      relay_clause (solver, share, from, glue, p - elits, elits);
+      p++;
+    }
+}
+
+// Clauses are relayed even if this solver ignores them, since others might
+// still have all their variables.  Thus they are also traced in proof
+// fragments with the fragment of the sender as origin.
+
+static void
+import_shared_clause (kissat * solver, share * share, enum level from,
+		      unsigned origin, unsigned glue, size_t size,
+		      const int *elits)
+{
+  if (filtered (share, hash_external_literals (size, elits)))
+    {
+      share->statistics.duplicated++;
+      return;
+    }
+#ifndef NPROOFS
+  if (solver->proof)
+    kissat_import_external_to_proof (solver, origin, size, elits);
+#else
+  (void) origin;
+#endif
+  relay_clause (solver, share, from, glue, size, elits);
+  if (kissat_import_external_clause (solver, glue, size, elits))
+    share->statistics.imported++;
+  else
+    share->statistics.ignored++;
+}
+
+static void
+import_batch (kissat * solver, share * share, enum level from,
+	      unsigned origin)
+{
+  const int *p = BEGIN_STACK (share->received);
+  const int *const end = END_STACK (share->received);
+  while (!solver->inconsistent && p != end)
+    {
+      const unsigned glue = *p++;
+      const int *const elits = p;
+      while (*p)
+	p++;
+      import_shared_clause (solver, share, from, origin,
+			    glue, p - elits, elits);
+      p++;
+    }
+  CLEAR_STACK (share->received);
+}
+
+// The enlarging function only doubles the capacity and thus we repeat it
+// until the whole (encoded or decoded) batch fits.
+
+#define RESERVE_STACK(S,N) \
+do { \
+  while (CAPACITY_STACK (S) < (size_t) (N)) \
+    kissat_stack_enlarge (solver, (chars *) &(S), sizeof *(S).begin); \
+} while (0)
+
+static enum level
+receive_batch (kissat * solver, share * share, MPI_Status * status,
+	       int *origin_ptr)
+{
+  int count;
+  MPI_Get_count (status, MPI_BYTE, &count);
+  const int source = status->MPI_SOURCE;
+  chars *bytes = &share->bytes;
+  RESERVE_STACK (*bytes, count);
+  MPI_Recv (BEGIN_STACK (*bytes), count, MPI_BYTE, source,
+	    CLAUSES_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  share->received_from[source]++;
+  share->statistics.batches++;
+  share->statistics.received += count;
+  ints *received = &share->received;
+  assert (EMPTY_STACK (*received));
+  RESERVE_STACK (*received, count);
+  int origin;
+  size_t decoded;
+  if (!kissat_decode_batch (count, (unsigned char *) BEGIN_STACK (*bytes),
+			    &origin, &decoded, BEGIN_STACK (*received)))
+    kissat_fatal ("malformed clause batch received from rank %d", source);
+  received->end = received->begin + decoded;
+  share->statistics.decoded += decoded * sizeof (int);
+  LOG ("received batch of %d bytes from rank %d (origin %d)",
+       count, source, origin);
+  *origin_ptr = origin;
+  const int *const leaders = share->leaders;
+  const int rank = kissat_portfolio_rank ();
+  return leaders[source] == leaders[rank] ? NODE_LEVEL : NODES_LEVEL;
+}
+
+static void
+receive_batches (kissat * solver, share * share)
+{
+  for (;;)
+    {
+      int flag;
+      MPI_Status status;
+      MPI_Iprobe (MPI_ANY_SOURCE, CLAUSES_TAG, MPI_COMM_WORLD,
+		  &flag, &status);
+      if (!flag)
+	break;
+      int origin;
+      const enum level from =
+	receive_batch (solver, share, &status, &origin);
+      import_batch (solver, share, from, kissat_fragment_index (origin, 0));
+    }
+}
+
+// The batch of a level is only sent if the previous batch of this level
+// left this rank already.  Otherwise relaying continues to fill the
+// current batch up to the limit of its level and drops clauses beyond.
+// Batches of the node level go to the other ranks on the same node and
+// batches of the nodes level to the leaders of the other nodes.
+
+static bool
+destination (const share * share, enum level level, int rank, int other)
+{
+  if (other == rank || kissat_cube_coordinator (other))
+    return false;
+  const int *const leaders = share->leaders;
+  if (level == NODE_LEVEL)
+    return leaders[other] == leaders[rank];
+  assert (level == NODES_LEVEL);
+  return leaders[other] == other && leaders[rank] != other;
+}
+
+static void
+send_batch (kissat * solver, share * share, enum level level)
+{
+  channel *const channel = share->channels + level;
+  if (!channel->enabled || EMPTY_STACK (channel->batch))
+    return;
+  if (channel->pending)
+    {
+      int flag;
+      MPI_Testall (channel->pending, channel->requests, &flag,
+		   MPI_STATUSES_IGNORE);
+      if (!flag)
+	return;
+      channel->pending = 0;
+    }
+  const size_t size = SIZE_STACK (channel->batch);
+  const int rank = kissat_portfolio_rank ();
+  chars *sending = &channel->sending;
+  CLEAR_STACK (*sending);
+  RESERVE_STACK (*sending, kissat_encoded_batch_bound (size));
+  const size_t bytes =
+    kissat_encode_batch (rank, size, BEGIN_STACK (channel->batch),
+			 (unsigned char *) BEGIN_STACK (*sending));
+  sending->end = sending->begin + bytes;
+  CLEAR_STACK (channel->batch);
+  share->statistics.encoded += size * sizeof (int);
+  const int count = bytes;
+  const int size_ranks = kissat_portfolio_size ();
+  for (int other = 0; other < size_ranks; other++)
+    if (destination (share, level, rank, other))
+      {
+	MPI_Isend (BEGIN_STACK (*sending), count, MPI_BYTE, other,
+		   CLAUSES_TAG, MPI_COMM_WORLD,
+		   channel->requests + channel->pending++);
+	share->sent_to[other]++;
+      }
+  share->statistics.sent += bytes;
+  LOG ("sent level %d batch of %d bytes to %d ranks",
+       (int) level, count, channel->pending);
+}
+
+// With threads the batch is published on our own ring and the batches
+// published by the other threads are consumed from their rings.  Neither
+// ever blocks.
+
+static void
+publish_batch (share * share)
+{
+  ints *const batch = &share->channels[RING_LEVEL].batch;
+  if (EMPTY_STACK (*batch))
+    return;
+  ring *ring = share->rings[share->thread];
+  kissat_publish_ring (ring, SIZE_STACK (*batch), BEGIN_STACK (*batch));
+  CLEAR_STACK (*batch);
+}
+
+static void
+consume_batches (kissat * solver, share * share)
+{
+  const unsigned thread = share->thread;
+  for (unsigned other = 0; other < share->threads; other++)
+    {
+      if (other == thread)
+	continue;
+      ring *ring = share->rings[other];
+      while (!solver->inconsistent &&
+	     kissat_consume_ring (solver, ring, thread, &share->received,
+				  &share->statistics.lost))
+	{
+	  share->statistics.batches++;
+	  const int rank = kissat_portfolio_rank ();
+	  import_batch (solver, share, RING_LEVEL,
+			kissat_fragment_index (rank, other));
+	}
+    }
+}
+
+static void
+distribute_exported (kissat * solver, share * share)
+{
+  relay_batch (solver, share, LEVELS, &share->exported);
+  CLEAR_STACK (share->exported);
+}
+
+// In deterministic mode all threads publish their batch at the first
+// restart after their search ticks reached the next multiple of the
+// '--sharesync' interval and wait for all others.  Then the batches of all
+// other threads are imported in thread order and the second barrier makes
+// sure that nobody publishes the next batch before all batches are
+// consumed (thus none is lost).  The search of each thread only depends on
+// its own ticks and the imported batches, but not on timing.  If any other
+// thread stopped before the first barrier was passed, all threads stop.
+
+bool
+kissat_synchronizing (kissat * solver)
+{
+  const share *const share = solver->share;
+  return share && share->barrier &&
+    solver->statistics.search_ticks >= share->synchronize;
+}
+
+static void
+synchronize_batches (kissat * solver, share * share)
+{
+  assert (kissat_synchronizing (solver));
+  while (share->synchronize <= solver->statistics.search_ticks)
+    share->synchronize += sync_interval (solver);
+  distribute_exported (solver, share);
+  publish_batch (share);
+  if (kissat_wait_barrier (share->barrier))
+    {
+      consume_batches (solver, share);
+      if (kissat_wait_barrier (share->barrier))
+	{
+	  share->statistics.synchronized++;
+	  return;
+	}
+    }
+  kissat_extremely_verbose (solver, "stopping at sharing barrier");
+  share->barrier = 0;
+  kissat_terminate (solver);
+}
+
+int
+kissat_share_clauses (kissat * solver)
+{
+  share *share = solver->share;
+  if (!share)
+    return 0;
+  assert (!solver->level);
+  assert (!solver->inconsistent);
+  if (share->barrier)
+    {
+      if (kissat_synchronizing (solver))
+	synchronize_batches (solver, share);
+      return solver->inconsistent ? 20 : 0;
+    }
+  distribute_exported (solver, share);
+  if (share->rings)
+    consume_batches (solver, share);
+  if (share->leaders)
+    {
+      if (!solver->inconsistent)
+	receive_batches (solver, share);
+      send_batch (solver, share, NODE_LEVEL);
+      const unsigned interval = GET_OPTION (sharenodes);
+      if (interval && !(++share->shared % interval))
+	send_batch (solver, share, NODES_LEVEL);
+    }
+  if (share->rings)
+    publish_batch (share);
+  return solver->inconsistent ? 20 : 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+wait_for_pending_sends (channel * channel)
+{
+  if (!channel->pending)
+    return;
+  MPI_Waitall (channel->pending, channel->requests, MPI_STATUSES_IGNORE);
+  channel->pending = 0;
+}
+
+// Releasing is collective.  Batches still in flight have to be received
+// (and are discarded) as otherwise large sends might never complete.  All
+// ranks first learn how many batches each of the others sent to them.
+// The cube coordinator only sends batches (while computing scores) but
+// never receives any, since it does not restart while distributing cubes
+// and thus nobody sends batches to it.
+
+static void
+drain_batches (kissat * solver, share * share)
+{
+  const int rank = kissat_portfolio_rank ();
+  const int size = kissat_portfolio_size ();
+  int *sent = kissat_nalloc (solver, size, sizeof (int));
+  MPI_Alltoall (share->sent_to, 1, MPI_INT, sent, 1, MPI_INT,
+		MPI_COMM_WORLD);
+  for (int other = 0; other < size; other++)
+    while (other != rank && share->received_from[other] < sent[other])
+      {
+	int origin;
+	MPI_Status status;
+	MPI_Probe (other, CLAUSES_TAG, MPI_COMM_WORLD, &status);
+	receive_batch (solver, share, &status, &origin);
+	CLEAR_STACK (share->received);
+      }
+  kissat_dealloc (solver, sent, size, sizeof (int));
+  wait_for_pending_sends (share->channels + NODE_LEVEL);
+  wait_for_pending_sends (share->channels + NODES_LEVEL);
+}
+
+void
+kissat_release_share (kissat * solver)
+{
+  share *share = solver->share;
+  if (!share)
+    return;
+  kissat_verbose (solver,
+		  "shared %" PRIu64 " exported %" PRIu64 " imported "
+		  "%" PRIu64 " duplicated %" PRIu64 " ignored %" PRIu64
+		  " dropped clauses in %" PRIu64 " batches (%" PRIu64
+		  " lost)", share->statistics.exported,
+		  share->statistics.imported, share->statistics.duplicated,
+		  share->statistics.ignored, share->statistics.dropped,
+		  share->statistics.batches, share->statistics.lost);
+  if (share->statistics.relayed)
+    kissat_verbose (solver, "relayed %" PRIu64 " clauses between levels",
+		    share->statistics.relayed);
+  if (share->statistics.synchronized)
+    kissat_verbose (solver, "synchronized sharing %" PRIu64 " times",
+		    share->statistics.synchronized);
+  if (share->leaders)
+    {
+      kissat_verbose (solver,
+		      "encoded %" PRIu64 " into %" PRIu64 " bytes (%.0f%%) "
+		      "and decoded %" PRIu64 " from %" PRIu64 " bytes",
+		      share->statistics.encoded, share->statistics.sent,
+		      kissat_percent (share->statistics.sent,
+				      share->statistics.encoded),
+		      share->statistics.decoded, share->statistics.received);
+      drain_batches (solver, share);
+      const int size = kissat_portfolio_size ();
+      for (unsigned level = NODE_LEVEL; level < LEVELS; level++)
+	if (share->channels[level].requests)
+	  kissat_dealloc (solver, share->channels[level].requests, size,
+			  sizeof (MPI_Request));
+      kissat_dealloc (solver, share->leaders, size, sizeof (int));
+      kissat_dealloc (solver, share->sent_to, size, sizeof (int));
+      kissat_dealloc (solver, share->received_from, size, sizeof (int));
+    }
+  for (unsigned level = 0; level < LEVELS; level++)
+    {
+      RELEASE_STACK (share->channels[level].batch);
+      RELEASE_STACK (share->channels[level].sending);
+    }
+  RELEASE_STACK (share->exported);
+  RELEASE_STACK (share->bytes);
+  RELEASE_STACK (share->received);
+  kissat_dealloc (solver, share->filter, SIZE_FILTER, sizeof (uint64_t));
+  kissat_free (solver, share, sizeof *share);
+  solver->share = 0;
+}
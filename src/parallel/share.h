@@ -0,0 +1,41 @@
+#ifndef _share_h_INCLUDED
+#define _share_h_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct kissat;
+struct barrier;
+struct ring;
+
+// Learned units, binary clauses and clauses with glue up to the tier
+// selected by '--sharetier' are exported in terms of external literals
+// (through 'solver->export') and collected into batches.  At restarts, the
+// solver is at the root level, the batch is sent to all other ranks and
+// the batches received in the meantime are imported through
+// 'solver->import'.  Clauses seen before are filtered out by hashing.
+// Solver threads within one process exchange the same batches through
+// lock-free rings instead (see 'ring.h').  Ranks on the same node (sharing
+// memory) exchange batches at every restart, while only the node leaders
+// exchange them with the other nodes (see '--sharenodes').  Received
+// clauses are relayed from one of these levels to the others.  With
+// '--sharesync' the solver threads of one process exchange their batches
+// deterministically at barriers every given number of search ticks, which
+// also forces a restart ('kissat_synchronizing').
+
+void kissat_init_share (struct kissat *);
+void kissat_init_ring_share (struct kissat *, unsigned thread,
+			     unsigned threads, struct ring **,
+			     struct barrier *);
+void kissat_release_share (struct kissat *);
+
+void kissat_export_learned_clause (struct kissat *, unsigned glue);
+int kissat_share_clauses (struct kissat *);
+bool kissat_synchronizing (struct kissat *);
+
+bool kissat_import_external_literals (struct kissat *,
+				      size_t size, const int *elits);
+bool kissat_import_external_clause (struct kissat *, unsigned glue,
+				    size_t size, const int *elits);
+
+#endif
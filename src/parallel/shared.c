@@ -0,0 +1,250 @@
+#include "shared.h"
+
+#include "allocate.h"
+#include "check.h"
+#include "collect.h"
+#include "error.h"
+#include "flags.h"
+#include "print.h"
+
+// Only clauses which still have more than three unassigned literals at the
+// root level are moved to the shared arena.  All others are copied to the
+// threads as before.  Copying ternary clauses takes less memory than the
+// private watch lists and watch states needed for sharing them, and keeps
+// them in the fast ternary propagation path ('ternary.c').
+
+bool
+kissat_shareable_clause (kissat * solver, clause * c)
+{
+  assert (!solver->level);
+  if (c->garbage || c->redundant)
+    return false;
+  const value *const values = solver->values;
+  unsigned unassigned = 0;
+  for (all_literals_in_clause (lit, c))
+    {
+      const value value = values[lit];
+      if (value > 0)
+	return false;
+      if (!value)
+	unassigned++;
+    }
+  return unassigned > 3;
+}
+
+shared_arena *
+kissat_new_shared_arena (kissat * solver)
+{
+  size_t size = 0;
+  unsigned size_clauses = 0;
+  for (all_clauses (c))
+    if (kissat_shareable_clause (solver, c))
+      {
+	size += kissat_bytes_of_clause (c->size) / sizeof (ward);
+	size_clauses++;
+      }
+  if (!size_clauses)
+    {
+      // Avoid restricting inprocessing for nothing (see 'threads.c').
+      kissat_message (solver, "no clauses to share");
+      return 0;
+    }
+  if (size_clauses > MAX_SHARED_CLAUSES)
+    kissat_fatal ("too many clauses (%u) for shared arena", size_clauses);
+  shared_arena *arena = kissat_calloc (solver, 1, sizeof *arena);
+  arena->begin = kissat_calloc (solver, size, sizeof (ward));
+  arena->clauses = kissat_calloc (solver, size_clauses, sizeof (reference));
+  arena->size = size;
+  const value *const values = solver->values;
+  ward *w = arena->begin;
+  for (all_clauses (c))
+    {
+      if (!kissat_shareable_clause (solver, c))
+	continue;
+      clause *d = (clause *) w;
+      d->glue = c->glue;
+      d->searched = 2;
+      unsigned *q = d->lits;
+      for (all_literals_in_clause (lit, c))
+	if (!values[lit])
+	  *q++ = lit;
+      d->size = q - d->lits;
+      arena->clauses[arena->size_clauses++] = w - arena->begin;
+      arena->lits += d->size;
+      w += kissat_bytes_of_clause (d->size) / sizeof (ward);
+    }
+  assert (arena->size_clauses == size_clauses);
+  assert (w <= arena->begin + size);
+  kissat_message (solver, "shared arena of %u clauses with %u literals "
+		  "(%zu bytes)", size_clauses, arena->lits,
+		  size * sizeof (ward));
+  return arena;
+}
+
+// The solver which created the arena gives up its own copies of the
+// shared clauses after the clones copied its other clauses.  Afterwards it
+// attaches the arena like the clones.
+
+void
+kissat_release_shareable_clauses (kissat * solver)
+{
+  assert (!solver->level);
+  assert (!solver->inconsistent);
+  size_t released = 0;
+  for (all_clauses (c))
+    if (kissat_shareable_clause (solver, c))
+      {
+	kissat_mark_clause_as_garbage (solver, c);
+	released++;
+      }
+  kissat_sparse_collect (solver, false, 0);
+  kissat_defrag_watches (solver);
+  kissat_message (solver, "released %zu private copies of shared clauses",
+		  released);
+}
+
+void
+kissat_release_shared_arena (kissat * solver, shared_arena * arena)
+{
+  kissat_dealloc (solver, arena->begin, arena->size, sizeof (ward));
+  kissat_dealloc (solver, arena->clauses,
+		  arena->size_clauses, sizeof (reference));
+  kissat_free (solver, arena, sizeof *arena);
+}
+
+#ifndef NDEBUG
+
+// Shared clauses are not added through 'kissat_add' and thus the internal
+// proof checker of the solver attaching the arena has to be told about
+// them explicitly.
+
+static void
+add_unchecked_shared_clause (kissat * solver, const clause * c)
+{
+  ints elits;
+  INIT_STACK (elits);
+  for (unsigned i = 0; i < c->size; i++)
+    PUSH_STACK (elits, kissat_export_literal (solver, c->lits[i]));
+  ADD_UNCHECKED_EXTERNAL (SIZE_STACK (elits), BEGIN_STACK (elits));
+  RELEASE_STACK (elits);
+}
+
+#endif
+
+// Needs the same internal variable indices as the solver which created
+// the arena, and thus has to be called after the formula was copied.
+// Variables are only activated by the clauses added to a solver, and
+// those only occurring in shared clauses have to be activated here.
+
+void
+kissat_attach_shared_arena (kissat * solver, const shared_arena * arena)
+{
+  assert (!solver->shared);
+  assert (!solver->level);
+  shared_clauses *shared = kissat_calloc (solver, 1, sizeof *shared);
+  const unsigned size_clauses = arena->size_clauses;
+  shared->arena = arena;
+  shared->states = kissat_calloc (solver, size_clauses,
+				  sizeof *shared->states);
+  shared->watches = kissat_calloc (solver, LITS, sizeof *shared->watches);
+  for (unsigned idx = 0; idx < size_clauses; idx++)
+    {
+      const clause *const c = kissat_shared_clause (arena, idx);
+      const unsigned lit0 = c->lits[0];
+      const unsigned lit1 = c->lits[1];
+      assert (!VALUE (lit0));
+      assert (!VALUE (lit1));
+      shared_state *const state = shared->states + idx;
+      state->watched[0] = lit0;
+      state->watched[1] = lit1;
+      state->searched = 2;
+      const shared_watch watch0 = {.blocking = lit1,.idx = idx };
+      const shared_watch watch1 = {.blocking = lit0,.idx = idx };
+      PUSH_STACK (shared->watches[lit0], watch0);
+      PUSH_STACK (shared->watches[lit1], watch1);
+      for (unsigned i = 0; i < c->size; i++)
+	kissat_activate_literal (solver, c->lits[i]);
+#ifndef NDEBUG
+      add_unchecked_shared_clause (solver, c);
+#endif
+    }
+  solver->shared = shared;
+  kissat_verbose (solver, "attached %u shared clauses", size_clauses);
+}
+
+void
+kissat_detach_shared_arena (kissat * solver)
+{
+  shared_clauses *shared = solver->shared;
+  if (!shared)
+    return;
+  for (all_literals (lit))
+    RELEASE_STACK (shared->watches[lit]);
+  kissat_dealloc (solver, shared->watches, LITS, sizeof *shared->watches);
+  kissat_dealloc (solver, shared->states, shared->arena->size_clauses,
+		  sizeof *shared->states);
+  kissat_free (solver, shared, sizeof *shared);
+  solver->shared = 0;
+}
+
+static void
+unwatch_shared_clause (shared_watches * watches, unsigned idx)
+{
+  shared_watch *const begin = BEGIN_STACK (*watches);
+  shared_watch *const end = END_STACK (*watches);
+  shared_watch *p = begin;
+  while (p != end && p->idx != idx)
+    p++;
+  assert (p != end);
+  while (++p != end)
+    p[-1] = *p;
+  watches->end--;
+}
+
+// A conflicting shared clause can not be reordered as in
+// 'one_literal_on_conflict_level' in 'analyze.c'.  Instead its watches are
+// moved to two literals on the highest levels, so that the watch invariant
+// still holds after chronological backtracking.
+
+void
+kissat_rewatch_shared_conflict (kissat * solver)
+{
+  shared_clauses *const shared = solver->shared;
+  const unsigned idx = shared->conflict;
+  clause *const c = kissat_shared_clause (shared->arena, idx);
+  const assigned *const all_assigned = solver->assigned;
+  unsigned highest[2] = { INVALID_LIT, INVALID_LIT };
+  unsigned levels[2] = { 0, 0 };
+  for (all_literals_in_clause (lit, c))
+    {
+      const unsigned level = all_assigned[IDX (lit)].level;
+      if (highest[0] == INVALID_LIT || level > levels[0])
+	{
+	  highest[1] = highest[0], levels[1] = levels[0];
+	  highest[0] = lit, levels[0] = level;
+	}
+      else if (highest[1] == INVALID_LIT || level > levels[1])
+	highest[1] = lit, levels[1] = level;
+    }
+  assert (highest[1] != INVALID_LIT);
+  shared_state *const state = shared->states + idx;
+  shared_watches *const all_watches = shared->watches;
+  for (unsigned i = 0; i < 2; i++)
+    {
+      const unsigned lit = state->watched[i];
+      if (lit != highest[0] && lit != highest[1])
+	unwatch_shared_clause (all_watches + lit, idx);
+    }
+  for (unsigned i = 0; i < 2; i++)
+    {
+      const unsigned lit = highest[i];
+      if (lit == state->watched[0] || lit == state->watched[1])
+	continue;
+      const shared_watch watch = {.blocking = highest[!i],.idx = idx };
+      PUSH_STACK (all_watches[lit], watch);
+    }
+  LOG ("shared clause[%u] rewatched by %s and %s", idx,
+       LOGLIT (highest[0]), LOGLIT (highest[1]));
+  state->watched[0] = highest[0];
+  state->watched[1] = highest[1];
+}
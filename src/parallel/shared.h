@@ -0,0 +1,138 @@
+#ifndef _shared_h_INCLUDED
+#define _shared_h_INCLUDED
+
+#include "inline.h"
+
+#include <stdbool.h>
+
+// With '--sharearena' solver threads do not copy the large irredundant
+// clauses of the main solver.  Instead these are moved once into an
+// immutable arena which is shared by all threads including the main solver,
+// which releases its own copies after cloning.  Clauses in this arena have
+// the same layout as in the private 'arena', but are never written.
+//
+// The price is that no thread can eliminate, substitute or sweep variables
+// or compact the variable range anymore (see 'restrict_to_shared_arena' in
+// 'threads.c'), since all of these rewrite irredundant clauses or their
+// literals.  Shared clauses are neither vivified nor subsumed during
+// probing, while local search ('walk.c') and the snapshots for helper
+// threads ('snapshot.h') include them.  On uniform random 3-SAT and 5-SAT
+// instances this restriction changed the single threaded run time of
+// unsatisfiable instances by less than 5%, but on structured instances,
+// where variable elimination matters most, the cost is certainly higher.
+// Only clauses with more than three literals are shared, so that sharing
+// pays off in memory on formulas with many long clauses.
+//
+// Since the watched literals can not be swapped to the front of a shared
+// clause, each thread keeps the two literals it watches and the position
+// where the last replacement was found in a small private 'shared_state'.
+// Shared clauses are watched in their own watch lists (separate from
+// 'solver->watches'), so that none of the inprocessing code touching the
+// regular watches ever sees them.  Reasons and conflicts pointing to a
+// shared clause use the clause index with the 'SHARED_REFERENCE' bit set,
+// which can never collide with a reference into the private arena.
+//
+// Thus all reasons have to be dereferenced with 'kissat_dereference_reason'
+// and code writing to reasons or conflicts (on-the-fly strengthening and
+// subsumption, reordering conflicts for chronological backtracking or
+// marking reasons during reduction) has to skip shared clauses.  The index
+// of the last conflicting shared clause is kept in 'conflict', since a
+// clause pointer into the shared arena can not be turned into a reference
+// with 'kissat_reference_clause'.
+
+typedef struct shared_arena shared_arena;
+typedef struct shared_clauses shared_clauses;
+typedef struct shared_state shared_state;
+typedef struct shared_watch shared_watch;
+
+struct shared_arena
+{
+  ward *begin;
+  size_t size;
+  reference *clauses;
+  unsigned size_clauses;
+  unsigned lits;
+};
+
+struct shared_state
+{
+  unsigned watched[2];
+  unsigned searched;
+};
+
+struct shared_watch
+{
+  unsigned blocking;
+  unsigned idx;
+};
+
+// *INDENT-OFF*
+typedef STACK (shared_watch) shared_watches;
+// *INDENT-ON*
+
+struct shared_clauses
+{
+  const shared_arena *arena;
+  shared_state *states;
+  shared_watches *watches;
+  unsigned conflict;
+};
+
+#define SHARED_REFERENCE (1u << LD_MAX_REF)
+#define MAX_SHARED_CLAUSES (UNIT_REASON - SHARED_REFERENCE)
+
+static inline bool
+kissat_shared_reference (reference ref)
+{
+  return SHARED_REFERENCE <= ref && ref < UNIT_REASON;
+}
+
+static inline clause *
+kissat_shared_clause (const shared_arena * arena, unsigned idx)
+{
+  assert (idx < arena->size_clauses);
+  return (clause *) (arena->begin + arena->clauses[idx]);
+}
+
+static inline clause *
+kissat_dereference_reason (kissat * solver, reference ref)
+{
+  if (!kissat_shared_reference (ref))
+    return kissat_dereference_clause (solver, ref);
+  return kissat_shared_clause (solver->shared->arena,
+			       ref - SHARED_REFERENCE);
+}
+
+static inline bool
+kissat_in_shared_arena (kissat * solver, const clause * c)
+{
+  const shared_clauses *const shared = solver->shared;
+  if (!shared)
+    return false;
+  const shared_arena *const arena = shared->arena;
+  const ward *const w = (const ward *) c;
+  return arena->begin <= w && w < arena->begin + arena->size;
+}
+
+static inline reference
+kissat_reference_conflict (kissat * solver, clause * c)
+{
+  if (!kissat_in_shared_arena (solver, c))
+    return kissat_reference_clause (solver, c);
+  const shared_clauses *const shared = solver->shared;
+  assert (kissat_shared_clause (shared->arena, shared->conflict) == c);
+  return SHARED_REFERENCE + shared->conflict;
+}
+
+bool kissat_shareable_clause (struct kissat *, clause *);
+
+shared_arena *kissat_new_shared_arena (struct kissat *);
+void kissat_release_shareable_clauses (struct kissat *);
+void kissat_release_shared_arena (struct kissat *, shared_arena *);
+
+void kissat_attach_shared_arena (struct kissat *, const shared_arena *);
+void kissat_detach_shared_arena (struct kissat *);
+
+void kissat_rewatch_shared_conflict (struct kissat *);
+
+#endif
@@ -0,0 +1,77 @@
+#include "snapshot.h"
+#include "shared.h"
+
+#include "inline.h"
+
+// Returns the number of pushed literals or zero if the clause was skipped,
+// in which case nothing is pushed.
+
+size_t
+kissat_push_snapshot_clause (kissat * solver, ints * snapshot, unsigned glue,
+			     size_t size, const unsigned *lits)
+{
+  const value *const values = solver->values;
+  const size_t saved = SIZE_STACK (*snapshot);
+  PUSH_STACK (*snapshot, glue);
+  for (size_t i = 0; i < size; i++)
+    {
+      const unsigned lit = lits[i];
+      const value value = values[lit];
+      if (value < 0)
+	continue;
+      const int elit = kissat_export_literal (solver, lit);
+      if (value > 0 || !elit)
+	{
+	  RESIZE_STACK (*snapshot, saved);
+	  return 0;
+	}
+      PUSH_STACK (*snapshot, elit);
+    }
+  const size_t pushed = SIZE_STACK (*snapshot) - saved - 1;
+  if (!pushed)
+    {
+      RESIZE_STACK (*snapshot, saved);
+      return 0;
+    }
+  PUSH_STACK (*snapshot, 0);
+  return pushed;
+}
+
+void
+kissat_push_snapshot_binaries (kissat * solver, ints * snapshot,
+			       bool redundant)
+{
+  assert (solver->watching);
+  const value *const values = solver->values;
+  for (all_literals (lit))
+    {
+      if (values[lit])
+	continue;
+      for (all_binary_blocking_watches (watch, WATCHES (lit)))
+	{
+	  if (!watch.type.binary)
+	    continue;
+	  if (!redundant && watch.binary.redundant)
+	    continue;
+	  const unsigned other = watch.binary.lit;
+	  if (lit > other)
+	    continue;
+	  const unsigned lits[2] = { lit, other };
+	  kissat_push_snapshot_clause (solver, snapshot, 0, 2, lits);
+	}
+    }
+}
+
+void
+kissat_push_snapshot_shared (kissat * solver, ints * snapshot)
+{
+  const shared_clauses *const shared = solver->shared;
+  if (!shared)
+    return;
+  const shared_arena *const arena = shared->arena;
+  for (unsigned idx = 0; idx < arena->size_clauses; idx++)
+    {
+      const clause *const c = kissat_shared_clause (arena, idx);
+      kissat_push_snapshot_clause (solver, snapshot, 0, c->size, c->lits);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef _snapshot_h_INCLUDED
+#define _snapshot_h_INCLUDED
+
+#include "stack.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct kissat;
+
+// Helper threads (background vivification and local search) never access
+// the solver but work on snapshots taken by the search thread at restarts.
+// A snapshot is a stack of clauses 'glue lits... 0' in external literals,
+// where a glue of zero denotes an irredundant clause.  Root-level satisfied
+// clauses and clauses with literals without external variable are skipped
+// and falsified literals removed.  Since the search thread does not keep
+// copies of the clauses in the shared arena (see 'shared.h') these have to
+// be pushed separately.
+
+size_t kissat_push_snapshot_clause (struct kissat *, ints *, unsigned glue,
+				    size_t size, const unsigned *lits);
+
+void kissat_push_snapshot_binaries (struct kissat *, ints *,
+				    bool redundant);
+void kissat_push_snapshot_shared (struct kissat *, ints *);
+
+#endif
@@ -0,0 +1,349 @@
+#include "subsumption.h"
+
+#include "allocate.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+#include "terminate.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// Number of candidates in a shard taken by a subsumer at once.
+
+#define SHARD 256
+
+typedef struct subsumer subsumer;
+typedef struct subsumption subsumption;
+
+struct subsumer
+{
+  pthread_t thread;
+  subsumption *subsumption;
+  value *marks;
+  uint64_t checks;
+  uint64_t steps;
+};
+
+struct subsumption
+{
+  kissat *solver;
+  unsigned size;		// Number of subsumers.
+  subsumer *subsumers;
+  const reference *candidates;
+  size_t scheduled;
+  unsigned *results;
+  unsigned *offsets;		// Occurrences of literals (LITS + 1).
+  unsigned *occurrences;	// Positions of connected candidates.
+  size_t connected;
+  uint64_t steps_limit;
+  _Atomic (size_t) next;	// First candidate of next shard.
+  _Atomic (uint64_t) steps;	// Forward steps including finished shards.
+};
+
+// As in 'connect_subsuming' of 'forward.c' each candidate is connected on
+// its literal with fewest occurrences, but here the occurrences are the
+// binary watches and all candidates with the literal.
+
+static void
+index_candidates (kissat * solver, subsumption * subsumption)
+{
+  const size_t scheduled = subsumption->scheduled;
+  const reference *const candidates = subsumption->candidates;
+  ward *const arena = BEGIN_STACK (solver->arena);
+  const flags *const all_flags = solver->flags;
+  const unsigned occlim = GET_OPTION (subsumeocclim);
+
+  unsigned *const counts = kissat_calloc (solver, LITS, sizeof (unsigned));
+  for (size_t i = 0; i < scheduled; i++)
+    {
+      clause *const c = (clause *) (arena + candidates[i]);
+      for (all_literals_in_clause (lit, c))
+	counts[lit]++;
+    }
+
+  unsigned *const connect = kissat_nalloc (solver, scheduled,
+					   sizeof (unsigned));
+  for (size_t i = 0; i < scheduled; i++)
+    {
+      clause *const c = (clause *) (arena + candidates[i]);
+      unsigned min_lit = INVALID_LIT;
+      size_t min_occs = MAX_SIZE_T;
+      bool subsume = true;
+      for (all_literals_in_clause (lit, c))
+	{
+	  const flags *const flags = all_flags + IDX (lit);
+	  if (!flags->active)
+	    continue;
+	  if (!flags->subsume)
+	    {
+	      subsume = false;
+	      break;
+	    }
+	  const size_t occs = SIZE_WATCHES (WATCHES (lit)) + counts[lit];
+	  if (min_lit != INVALID_LIT && occs > min_occs)
+	    continue;
+	  min_lit = lit;
+	  min_occs = occs;
+	}
+      if (!subsume || min_occs > occlim)
+	min_lit = INVALID_LIT;
+      connect[i] = min_lit;
+    }
+
+  unsigned *const offsets =
+    kissat_calloc (solver, LITS + 1, sizeof (unsigned));
+  size_t connected = 0;
+  for (size_t i = 0; i < scheduled; i++)
+    if (connect[i] != INVALID_LIT)
+      offsets[connect[i] + 1]++, connected++;
+  for (all_literals (lit))
+    offsets[lit + 1] += offsets[lit];
+
+  unsigned *const occurrences =
+    kissat_nalloc (solver, connected, sizeof (unsigned));
+  memcpy (counts, offsets, LITS * sizeof (unsigned));
+  for (size_t i = 0; i < scheduled; i++)
+    if (connect[i] != INVALID_LIT)
+      occurrences[counts[connect[i]]++] = i;
+
+  kissat_dealloc (solver, connect, scheduled, sizeof (unsigned));
+  kissat_dealloc (solver, counts, LITS, sizeof (unsigned));
+
+  subsumption->offsets = offsets;
+  subsumption->occurrences = occurrences;
+  subsumption->connected = connected;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+forward_binaries (subsumer * subsumer, unsigned lit, unsigned *remove,
+		  unsigned limit)
+{
+  kissat *const solver = subsumer->subsumption->solver;
+  watches *const watches = &WATCHES (lit);
+  const size_t size_watches = SIZE_WATCHES (*watches);
+  if (!size_watches || size_watches > limit)
+    return false;
+  subsumer->steps += 1 + kissat_cache_lines (size_watches, sizeof (watch));
+  const value *const marks = subsumer->marks;
+  for (all_binary_large_watches (watch, *watches))
+    {
+      if (!watch.type.binary)
+	continue;
+      const unsigned other = watch.binary.lit;
+      if (marks[other])
+	return true;
+      const unsigned not_other = NOT (other);
+      if (marks[not_other])
+	{
+	  *remove = not_other;
+	  break;
+	}
+    }
+  return false;
+}
+
+// Only candidates before the given position are considered, which makes
+// sure that of two duplicated candidates only the second is subsumed.
+
+static bool
+forward_indexed (subsumer * subsumer, unsigned lit, size_t position,
+		 unsigned *remove, unsigned limit)
+{
+  subsumption *const subsumption = subsumer->subsumption;
+  kissat *const solver = subsumption->solver;
+  const unsigned *p = subsumption->occurrences + subsumption->offsets[lit];
+  const unsigned *const end =
+    subsumption->occurrences + subsumption->offsets[lit + 1];
+  const size_t size_occurrences = end - p;
+  if (!size_occurrences || size_occurrences > limit)
+    return false;
+
+  uint64_t steps = 1 + kissat_cache_lines (size_occurrences,
+					   sizeof (unsigned));
+  uint64_t checks = 0;
+
+  const reference *const candidates = subsumption->candidates;
+  const value *const values = solver->values;
+  const value *const marks = subsumer->marks;
+  ward *const arena = BEGIN_STACK (solver->arena);
+
+  bool subsume = false;
+
+  while (p != end && steps <= limit)
+    {
+      const unsigned other_position = *p++;
+      if (other_position >= position)
+	break;
+      clause *const d =
+	(clause *) (arena + candidates[other_position]);
+      steps++;
+      checks++;
+      subsume = true;
+
+      unsigned candidate = INVALID_LIT;
+
+      for (all_literals_in_clause (other, d))
+	{
+	  if (marks[other])
+	    continue;
+	  if (values[other] < 0)
+	    continue;
+	  if (!subsume)
+	    {
+	      candidate = INVALID_LIT;
+	      break;
+	    }
+	  subsume = false;
+	  const unsigned not_other = NOT (other);
+	  if (!marks[not_other])
+	    break;
+	  candidate = not_other;
+	}
+
+      if (subsume)
+	break;
+
+      if (candidate != INVALID_LIT)
+	*remove = candidate;
+    }
+
+  subsumer->steps += steps;
+  subsumer->checks += checks;
+
+  return subsume;
+}
+
+static unsigned
+forward_candidate (subsumer * subsumer, size_t position)
+{
+  subsumption *const subsumption = subsumer->subsumption;
+  kissat *const solver = subsumption->solver;
+  ward *const arena = BEGIN_STACK (solver->arena);
+  clause *const c =
+    (clause *) (arena + subsumption->candidates[position]);
+  const value *const values = solver->values;
+  const flags *const flags = solver->flags;
+  value *const marks = subsumer->marks;
+  const unsigned limit = GET_OPTION (subsumeocclim);
+
+  for (all_literals_in_clause (lit, c))
+    if (!values[lit])
+      marks[lit] = 1;
+
+  subsumer->steps++;
+
+  unsigned remove = INVALID_LIT;
+  bool subsume = false;
+
+  for (all_literals_in_clause (lit, c))
+    {
+      if (!flags[IDX (lit)].active)
+	continue;
+      if (forward_binaries (subsumer, lit, &remove, limit) ||
+	  forward_indexed (subsumer, lit, position, &remove, limit) ||
+	  forward_indexed (subsumer, NOT (lit), position, &remove, limit))
+	{
+	  subsume = true;
+	  break;
+	}
+    }
+
+  for (all_literals_in_clause (lit, c))
+    marks[lit] = 0;
+
+  return subsume ? FORWARD_SUBSUMED : remove;
+}
+
+static void *
+forward_shards (void *ptr)
+{
+  subsumer *subsumer = ptr;
+  subsumption *const subsumption = subsumer->subsumption;
+  const size_t scheduled = subsumption->scheduled;
+  unsigned *const results = subsumption->results;
+  for (;;)
+    {
+      if (atomic_load_explicit (&subsumption->steps, memory_order_relaxed) >
+	  subsumption->steps_limit)
+	break;
+      const size_t begin = atomic_fetch_add (&subsumption->next, SHARD);
+      if (begin >= scheduled)
+	break;
+      const size_t end = MIN (begin + SHARD, scheduled);
+      const uint64_t steps = subsumer->steps;
+      for (size_t position = begin; position != end; position++)
+	results[position] = forward_candidate (subsumer, position);
+      atomic_fetch_add (&subsumption->steps, subsumer->steps - steps);
+    }
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+kissat_forward_subsume_in_parallel (kissat * solver,
+				    references * candidates,
+				    uint64_t steps_limit, unsigned *results)
+{
+  const size_t scheduled = SIZE_STACK (*candidates);
+  for (size_t i = 0; i < scheduled; i++)
+    results[i] = FORWARD_UNCHECKED;
+  if (TERMINATED (forward_terminated_1))
+    return;
+
+  subsumption subsumption;
+  memset (&subsumption, 0, sizeof subsumption);
+  subsumption.solver = solver;
+  subsumption.candidates = BEGIN_STACK (*candidates);
+  subsumption.scheduled = scheduled;
+  subsumption.results = results;
+  subsumption.steps_limit = steps_limit;
+  atomic_init (&subsumption.next, 0);
+  atomic_init (&subsumption.steps, solver->statistics.forward_steps);
+  index_candidates (solver, &subsumption);
+
+  const unsigned size = GET_OPTION (forwardthreads);
+  subsumer *const subsumers = kissat_calloc (solver, size, sizeof *subsumers);
+  subsumption.size = size;
+  subsumption.subsumers = subsumers;
+  for (unsigned i = 0; i < size; i++)
+    {
+      subsumer *subsumer = subsumers + i;
+      subsumer->subsumption = &subsumption;
+      subsumer->marks = kissat_calloc (solver, LITS, sizeof (value));
+    }
+
+  for (unsigned i = 1; i < size; i++)
+    if (pthread_create (&subsumers[i].thread, 0, forward_shards,
+			subsumers + i))
+      kissat_fatal ("failed to create subsumer thread %u", i);
+  forward_shards (subsumers);
+  for (unsigned i = 1; i < size; i++)
+    if (pthread_join (subsumers[i].thread, 0))
+      kissat_fatal ("failed to join subsumer thread %u", i);
+
+  uint64_t checks = 0, steps = 0;
+  for (unsigned i = 0; i < size; i++)
+    {
+      subsumer *subsumer = subsumers + i;
+      checks += subsumer->checks;
+      steps += subsumer->steps;
+      kissat_dealloc (solver, subsumer->marks, LITS, sizeof (value));
+    }
+  ADD (subsumption_checks, checks);
+  ADD (forward_checks, checks);
+  ADD (forward_steps, steps);
+
+  kissat_very_verbose (solver, "%u threads checked %zu candidates against "
+		       "%zu connected with %" PRIu64 " steps", size,
+		       scheduled, subsumption.connected, steps);
+
+  kissat_dealloc (solver, subsumers, size, sizeof *subsumers);
+  kissat_dealloc (solver, subsumption.occurrences, subsumption.connected,
+		  sizeof (unsigned));
+  kissat_dealloc (solver, subsumption.offsets, LITS + 1, sizeof (unsigned));
+}
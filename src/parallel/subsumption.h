@@ -0,0 +1,31 @@
+#ifndef _subsumption_h_INCLUDED
+#define _subsumption_h_INCLUDED
+
+#include "literal.h"
+#include "reference.h"
+
+#include <stdint.h>
+
+struct kissat;
+
+// Forward subsumption with several threads.  The candidates (sorted by
+// size) are indexed once by connecting each on one literal as in the
+// sequential algorithm, but in a read-only occurrence index private to
+// this pass instead of the watches.  The candidates are then split into
+// shards, which subsumer threads take one after the other and check each
+// candidate against the binary clauses and the indexed candidates before
+// it using their own marks.  The result for each candidate is either
+// 'FORWARD_SUBSUMED', a literal to be removed, 'INVALID_LIT' (nothing
+// found) or 'FORWARD_UNCHECKED' (effort limit hit or terminated).  Marking
+// garbage and strengthening is left to the caller, which commits all
+// results afterwards in candidate order (see 'forward.c').
+
+#define FORWARD_SUBSUMED (INVALID_LIT - 1)
+#define FORWARD_UNCHECKED (INVALID_LIT - 2)
+
+void kissat_forward_subsume_in_parallel (struct kissat *,
+					 references * candidates,
+					 uint64_t steps_limit,
+					 unsigned *results);
+
+#endif
@@ -0,0 +1,385 @@
+#include "threads.h"
+#include "barrier.h"
+#include "portfolio.h"
+#include "ring.h"
+#include "share.h"
+#include "shared.h"
+#include "vivifier.h"
+#include "walkers.h"
+
+#include "../file_utils/fragment.h"
+
+#include "allocate.h"
+#include "counters.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+#include "proof.h"
+#include "ternary.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct worker worker;
+
+struct worker
+{
+  unsigned id;
+  int res;
+  kissat *solver;
+  pthread_t thread;
+};
+
+static struct
+{
+  unsigned size;
+  worker *workers;
+  ring **rings;
+  barrier *barrier;
+  shared_arena *arena;
+  _Atomic (int) winner;
+} threads = {.size = 1 };
+
+static unsigned
+parse_threads (const char *arg, const char *str)
+{
+  int res;
+  if (!kissat_parse_option_value (str, &res) || res < 1)
+    kissat_error ("invalid number of threads in '%s'", arg);
+  return res;
+}
+
+unsigned
+kissat_init_threads (int *argc_ptr, char ***argv_ptr)
+{
+  const int argc = *argc_ptr;
+  char **argv = *argv_ptr;
+  int j = 1;
+  for (int i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      if (!strcmp (arg, "-t") && i + 1 < argc)
+	threads.size = parse_threads (arg, argv[++i]);
+      else if (!strncmp (arg, "--threads=", 10))
+	threads.size = parse_threads (arg, arg + 10);
+      else
+	argv[j++] = argv[i];
+    }
+  argv[j] = 0;
+  *argc_ptr = j;
+  return threads.size;
+}
+
+unsigned
+kissat_threads (void)
+{
+  return threads.size;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+push_external_literal (kissat * solver, ints * external, unsigned ilit)
+{
+  const int elit = kissat_export_literal (solver, ilit);
+  assert (elit);
+  PUSH_STACK (*external, elit);
+}
+
+// With proof fragments the clone imports the copied clauses from the
+// fragment of the main solver (see 'fragment.h').
+
+static void
+add_external_clause (kissat * solver, kissat * clone, ints * external)
+{
+#ifndef NPROOFS
+  if (clone->proof)
+    {
+      const unsigned origin =
+	kissat_fragment_index (kissat_portfolio_rank (), 0);
+      kissat_import_external_to_proof (clone, origin, SIZE_STACK (*external),
+				       BEGIN_STACK (*external));
+    }
+#endif
+  for (all_stack (int, elit, *external))
+    kissat_add (clone, elit);
+  kissat_add (clone, 0);
+  CLEAR_STACK (*external);
+}
+
+// Before solving the main solver only contains the parsed formula: root
+// level units, irredundant binary clauses in watch lists and irredundant
+// large clauses in the arena.  These are added to the clone in terms of
+// external literals, which is all clause sharing relies on.  Clauses in
+// the shared arena are skipped.  Since these use internal literals of the
+// main solver, the clone first imports all variables in the same order
+// (through tautological clauses, which are not added).
+
+static void
+copy_formula (kissat * solver, kissat * clone)
+{
+  const size_t size_import = SIZE_STACK (solver->import);
+  if (size_import > 1)
+    kissat_reserve (clone, size_import - 1);
+  ints external;
+  INIT_STACK (external);
+  if (solver->inconsistent)
+    {
+      add_external_clause (solver, clone, &external);
+      return;
+    }
+  if (threads.arena)
+    for (all_variables (idx))
+      {
+	const int elit = kissat_export_literal (solver, LIT (idx));
+	assert (elit);
+	kissat_add (clone, elit);
+	kissat_add (clone, -elit);
+	kissat_add (clone, 0);
+      }
+  for (all_variables (idx))
+    {
+      const unsigned lit = LIT (idx);
+      const value value = kissat_fixed (solver, lit);
+      if (!value)
+	continue;
+      push_external_literal (solver, &external, value < 0 ? NOT (lit) : lit);
+      add_external_clause (solver, clone, &external);
+    }
+  for (all_literals (lit))
+    {
+      watches *watches = &WATCHES (lit);
+      for (all_binary_blocking_watches (watch, *watches))
+	{
+	  if (!watch.type.binary)
+	    continue;
+	  if (watch.binary.redundant)
+	    continue;
+	  const unsigned other = watch.binary.lit;
+	  if (lit > other)
+	    continue;
+	  push_external_literal (solver, &external, lit);
+	  push_external_literal (solver, &external, other);
+	  add_external_clause (solver, clone, &external);
+	}
+    }
+  for (all_clauses (c))
+    {
+      if (c->garbage || c->redundant)
+	continue;
+      if (threads.arena && kissat_shareable_clause (solver, c))
+	continue;
+      for (all_literals_in_clause (lit, c))
+	push_external_literal (solver, &external, lit);
+      add_external_clause (solver, clone, &external);
+    }
+  RELEASE_STACK (external);
+}
+
+// With several ranks (see 'portfolio.h') each thread is configured by its
+// identifier among all threads of all ranks.
+
+static void
+configure_worker (kissat * solver, unsigned id)
+{
+  const unsigned rank = kissat_portfolio_rank ();
+  const unsigned ranks = kissat_portfolio_size ();
+  kissat_configure_solver (solver, rank * threads.size + id,
+			   ranks * threads.size);
+}
+
+// Shared clauses use the internal literals of the main solver and are
+// immutable.  Variables have to be imported in the order they are added
+// (see 'copy_formula') and neither renumbering variables (compacting) nor
+// rewriting irredundant clauses (elimination, substitution and sweeping)
+// is possible in any thread attaching the arena, including the main solver
+// after it released its own copies of the shared clauses.
+
+static void
+restrict_to_shared_arena (kissat * solver)
+{
+  kissat_set_option (solver, "tumble", 1);
+  kissat_set_option (solver, "compact", 0);
+  kissat_set_option (solver, "eliminate", 0);
+  kissat_set_option (solver, "substitute", 0);
+  kissat_set_option (solver, "sweep", 0);
+}
+
+static kissat *
+clone_solver (kissat * solver, unsigned id)
+{
+  kissat *clone = kissat_init ();
+#ifndef NOPTIONS
+  clone->options = solver->options;
+#endif
+  configure_worker (clone, id);
+  kissat_open_fragment (clone, id);
+  if (threads.arena)
+    restrict_to_shared_arena (clone);
+  copy_formula (solver, clone);
+  if (threads.arena)
+    kissat_attach_shared_arena (clone, threads.arena);
+  kissat_init_counters (clone);
+  kissat_init_ternary (clone);
+  if (!GET_OPTION (sharesync))
+    {
+      kissat_init_vivifier (clone);
+      kissat_init_walkers (clone);
+    }
+  return clone;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+terminate_other_workers (unsigned id)
+{
+  for (unsigned other = 0; other < threads.size; other++)
+    if (other != id)
+      kissat_terminate (threads.workers[other].solver);
+}
+
+// In deterministic mode the other threads only stop at the next barrier
+// (see 'share.c').  All threads stopping before that barrier is passed
+// stopped in the same interval of their search ticks and of those the
+// thread with the smallest identifier and a result wins.
+
+static void
+select_winner (void)
+{
+  for (unsigned id = 0; id < threads.size; id++)
+    if (threads.workers[id].res)
+      {
+	atomic_store (&threads.winner, (int) id);
+	break;
+      }
+}
+
+static void *
+solve_thread (void *ptr)
+{
+  worker *worker = ptr;
+  worker->res = kissat_solve (worker->solver);
+  if (threads.barrier)
+    kissat_leave_barrier (threads.barrier);
+  else if (worker->res)
+    {
+      int expected = -1;
+      if (atomic_compare_exchange_strong (&threads.winner, &expected,
+					  (int) worker->id))
+	terminate_other_workers (worker->id);
+    }
+  return 0;
+}
+
+// The main solver runs on the calling thread.  If it stops without result
+// (it hit a limit or was terminated by a signal) all others are stopped.
+
+int
+kissat_solve_threads (kissat * solver, kissat ** winner)
+{
+  const unsigned size = threads.size;
+  assert (size > 1);
+  threads.workers = kissat_calloc (solver, size, sizeof *threads.workers);
+  threads.rings = kissat_calloc (solver, size, sizeof *threads.rings);
+  atomic_init (&threads.winner, -1);
+  const unsigned ld_ring = GET_OPTION (sharering);
+  // Clones would not trace clauses in the shared arena in their fragments
+  // and the proof would contain the deletion of the released clauses.
+  if (GET_OPTION (sharearena) && !kissat_fragments () &&
+      !kissat_proving (solver) && !solver->inconsistent)
+    threads.arena = kissat_new_shared_arena (solver);
+  if (GET_OPTION (share) && GET_OPTION (sharesync) &&
+      kissat_portfolio_size () == 1)
+    threads.barrier = kissat_new_barrier (solver, size);
+  configure_worker (solver, 0);
+  for (unsigned id = 0; id < size; id++)
+    {
+      worker *worker = threads.workers + id;
+      worker->id = id;
+      worker->solver = id ? clone_solver (solver, id) : solver;
+      threads.rings[id] = kissat_new_ring (solver, ld_ring, size);
+    }
+  if (threads.arena)
+    {
+      restrict_to_shared_arena (solver);
+      kissat_release_shareable_clauses (solver);
+      kissat_attach_shared_arena (solver, threads.arena);
+    }
+  for (unsigned id = 0; id < size; id++)
+    kissat_init_ring_share (threads.workers[id].solver,
+			    id, size, threads.rings, threads.barrier);
+  if (threads.barrier && !solver->share)
+    {
+      kissat_release_barrier (solver, threads.barrier);
+      threads.barrier = 0;
+    }
+  if (threads.barrier)
+    {
+      // Background threads would make the search depend on timing.
+      kissat_release_walkers (solver);
+      kissat_release_vivifier (solver);
+      kissat_message (solver, "solving with %u threads deterministically",
+		      size);
+    }
+  else
+    kissat_message (solver, "solving with %u threads", size);
+  for (unsigned id = 1; id < size; id++)
+    {
+      worker *worker = threads.workers + id;
+      if (pthread_create (&worker->thread, 0, solve_thread, worker))
+	kissat_fatal ("failed to create solver thread %u", id);
+    }
+  solve_thread (threads.workers);
+  if (!threads.barrier && !threads.workers[0].res)
+    terminate_other_workers (0);
+  for (unsigned id = 1; id < size; id++)
+    if (pthread_join (threads.workers[id].thread, 0))
+      kissat_fatal ("failed to join solver thread %u", id);
+  if (threads.barrier)
+    select_winner ();
+  const int id = atomic_load (&threads.winner);
+  if (id < 0)
+    {
+      *winner = solver;
+      return 0;
+    }
+  kissat_message (solver, "thread %d won", id);
+  *winner = threads.workers[id].solver;
+  return threads.workers[id].res;
+}
+
+void
+kissat_release_threads (kissat * solver)
+{
+  if (!threads.workers)
+    return;
+  const unsigned size = threads.size;
+  for (unsigned id = 0; id < size; id++)
+    {
+      kissat *clone = threads.workers[id].solver;
+      kissat_release_share (clone);
+      kissat_detach_shared_arena (clone);
+      if (id)
+	{
+	  kissat_release_walkers (clone);
+	  kissat_release_vivifier (clone);
+	  kissat_close_fragment (clone, id);
+	  kissat_release_ternary (clone);
+	  kissat_release_counters (clone);
+	  kissat_release (clone);
+	}
+      kissat_release_ring (solver, threads.rings[id]);
+    }
+  if (threads.barrier)
+    kissat_release_barrier (solver, threads.barrier);
+  if (threads.arena)
+    kissat_release_shared_arena (solver, threads.arena);
+  kissat_dealloc (solver, threads.rings, size, sizeof *threads.rings);
+  kissat_dealloc (solver, threads.workers, size, sizeof *threads.workers);
+  threads.workers = 0;
+  threads.rings = 0;
+  threads.barrier = 0;
+  threads.arena = 0;
+}
@@ -0,0 +1,23 @@
+#ifndef _threads_h_INCLUDED
+#define _threads_h_INCLUDED
+
+struct kissat;
+
+// Running 'ssat -t N ...' (or '--threads=N') solves the formula with 'N'
+// differently configured solver instances in one process, each running on
+// its own POSIX thread.  The formula is only parsed once into the main
+// solver and copied to the other instances before solving starts.  Learned
+// clauses are exchanged through lock-free rings (see 'ring.h').  With
+// '--sharesync=<n>' the threads exchange clauses only at barriers every
+// 'n' thousand search ticks instead (see 'barrier.h'), which makes runs
+// with the same options and number of threads reproducible.  Combined
+// with '--portfolio' the main thread of each rank also shares the clauses
+// of its threads with other ranks (see 'share.h').
+
+unsigned kissat_init_threads (int *argc_ptr, char ***argv_ptr);
+unsigned kissat_threads (void);
+
+int kissat_solve_threads (struct kissat *, struct kissat **winner);
+void kissat_release_threads (struct kissat *);
+
+#endif
@@ -0,0 +1,648 @@
+#include "vivifier.h"
+#include "buffer.h"
+#include "share.h"
+#include "snapshot.h"
+
+#include "allocate.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Size of the direct mapped table of hashes of strengthened clauses, which
+// avoids that the same strengthening is queued again for later snapshots.
+
+#define SIZE_FILTER (1u << 16)
+
+typedef struct engine engine;
+typedef struct origin origin;
+typedef struct vivifier vivifier;
+typedef struct vwatch vwatch;
+
+// Irredundant large clauses of the snapshot remember where they came from,
+// so that their strengthened version can replace them (see 'replace').
+
+struct origin
+{
+  size_t offset;		// Position of clause in snapshot.
+  reference ref;		// Clause in arena of search thread.
+  unsigned size;		// Size of clause at snapshot time.
+  uint64_t hash;		// Hash of its literals at snapshot time.
+};
+
+struct vwatch
+{
+  unsigned blocking;
+  unsigned ref;
+};
+
+// *INDENT-OFF*
+typedef BUFFER (int) ibuffer;
+typedef BUFFER (unsigned) ubuffer;
+typedef BUFFER (vwatch) vwatches;
+typedef STACK (origin) origins;
+// *INDENT-ON*
+
+// Literals of the helper are encoded as '2*idx + sign' of the external
+// literal.  Clauses are stored as 'glue origin size lits...' in its own
+// arena, where a glue of zero denotes an irredundant clause and 'origin'
+// is the index in 'origins' or 'UINT_MAX' if the clause has none.
+
+struct engine
+{
+  size_t lits;
+  signed char *values;
+  vwatches *watches;
+  unsigned *trail;
+  size_t assigned, propagated;
+  bool inconsistent;
+  ubuffer arena;
+  ubuffer candidates;
+  ubuffer literals;
+  ubuffer kept;
+};
+
+struct vivifier
+{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wakeup;
+  bool ready;			// Snapshot waiting for helper (locked).
+  bool busy;			// Helper working on snapshot (locked).
+  _Atomic (bool) stop;		// Helper asked to terminate.
+  unsigned vars;		// External variables plus one.
+  ints snapshot;		// Clauses 'glue lits... 0' for the helper.
+  origins origins;		// Origins of clauses in snapshot.
+  ibuffer results;		// Strengthened clauses (locked).
+  ints imported;		// Taken over 'glue origin lits... 0'.
+  uint64_t *filter;		// Hashes of strengthened clauses.
+  uint64_t next;		// Conflicts at next snapshot.
+  engine engine;		// Helper propagation state.
+  struct
+  {
+    uint64_t snapshots;
+    uint64_t vivified;
+    uint64_t strengthened;
+    uint64_t imported;
+    uint64_t replaced;
+  } statistics;
+};
+
+/*------------------------------------------------------------------------*/
+
+static unsigned
+encode_literal (int elit)
+{
+  return 2u * ABS (elit) + (elit < 0);
+}
+
+static int
+decode_literal (unsigned ulit)
+{
+  const int idx = ulit / 2;
+  return (ulit & 1) ? -idx : idx;
+}
+
+static void
+reset_engine (engine * engine, unsigned vars)
+{
+  const size_t lits = 2 * (size_t) vars;
+  if (lits > engine->lits)
+    {
+      REALLOCATE_BUFFER (engine->values, lits);
+      REALLOCATE_BUFFER (engine->watches, lits);
+      memset (engine->watches + engine->lits, 0,
+	      (lits - engine->lits) * sizeof (vwatches));
+      REALLOCATE_BUFFER (engine->trail, vars);
+      engine->lits = lits;
+    }
+  memset (engine->values, 0, lits);
+  for (size_t lit = 0; lit < lits; lit++)
+    engine->watches[lit].size = 0;
+  engine->assigned = engine->propagated = 0;
+  engine->inconsistent = false;
+  engine->arena.size = 0;
+  engine->candidates.size = 0;
+}
+
+static void
+release_engine (engine * engine)
+{
+  for (size_t lit = 0; lit < engine->lits; lit++)
+    free (engine->watches[lit].begin);
+  free (engine->watches);
+  free (engine->values);
+  free (engine->trail);
+  free (engine->arena.begin);
+  free (engine->candidates.begin);
+  free (engine->literals.begin);
+  free (engine->kept.begin);
+}
+
+static void
+assign (engine * engine, unsigned lit)
+{
+  signed char *const values = engine->values;
+  assert (!values[lit]);
+  values[lit] = 1;
+  values[lit ^ 1] = -1;
+  engine->trail[engine->assigned++] = lit;
+}
+
+static void
+backtrack (engine * engine, size_t level)
+{
+  signed char *const values = engine->values;
+  while (engine->assigned > level)
+    {
+      const unsigned lit = engine->trail[--engine->assigned];
+      values[lit] = values[lit ^ 1] = 0;
+    }
+  engine->propagated = level;
+}
+
+// Returns 'false' on conflict.
+
+static bool
+propagate (engine * engine)
+{
+  const signed char *const values = engine->values;
+  unsigned *const arena = engine->arena.begin;
+  while (engine->propagated < engine->assigned)
+    {
+      const unsigned lit = engine->trail[engine->propagated++];
+      const unsigned not_lit = lit ^ 1;
+      vwatches *const watches = engine->watches + not_lit;
+      vwatch *const begin = watches->begin, *q = begin;
+      const vwatch *const end = begin + watches->size, *p = q;
+      bool conflict = false;
+      while (!conflict && p != end)
+	{
+	  const vwatch watch = *q++ = *p++;
+	  if (values[watch.blocking] > 0)
+	    continue;
+	  const unsigned size = arena[watch.ref + 2];
+	  unsigned *const lits = arena + watch.ref + 3;
+	  if (lits[0] == not_lit)
+	    lits[0] = lits[1], lits[1] = not_lit;
+	  const unsigned other = lits[0];
+	  if (values[other] > 0)
+	    {
+	      q[-1].blocking = other;
+	      continue;
+	    }
+	  unsigned k = 2;
+	  while (k < size && values[lits[k]] < 0)
+	    k++;
+	  if (k < size)
+	    {
+	      const unsigned replacement = lits[k];
+	      lits[1] = replacement;
+	      lits[k] = not_lit;
+	      const vwatch moved = {.blocking = other,.ref = watch.ref };
+	      PUSH_BUFFER (engine->watches[replacement], moved);
+	      q--;
+	    }
+	  else if (values[other] < 0)
+	    conflict = true;
+	  else
+	    assign (engine, other);
+	}
+      while (p != end)
+	*q++ = *p++;
+      watches->size = q - begin;
+      if (conflict)
+	return false;
+    }
+  return true;
+}
+
+static void
+load_snapshot (vivifier * vivifier, engine * engine)
+{
+  reset_engine (engine, vivifier->vars);
+  const int *const begin = BEGIN_STACK (vivifier->snapshot);
+  const int *const end = END_STACK (vivifier->snapshot);
+  const origin *const origins = BEGIN_STACK (vivifier->origins);
+  const origin *const end_origins = END_STACK (vivifier->origins);
+  const origin *o = origins;
+  const int *p = begin;
+  while (p != end)
+    {
+      unsigned id = UINT_MAX;
+      if (o != end_origins && o->offset == (size_t) (p - begin))
+	id = o++ - origins;
+      const unsigned glue = *p++;
+      const int *const elits = p;
+      while (*p)
+	p++;
+      const unsigned size = p++ - elits;
+      if (!size)
+	{
+	  engine->inconsistent = true;
+	  continue;
+	}
+      if (size == 1)
+	{
+	  const unsigned unit = encode_literal (elits[0]);
+	  const signed char value = engine->values[unit];
+	  if (value < 0)
+	    engine->inconsistent = true;
+	  else if (!value)
+	    assign (engine, unit);
+	  continue;
+	}
+      const unsigned ref = engine->arena.size;
+      PUSH_BUFFER (engine->arena, glue);
+      PUSH_BUFFER (engine->arena, id);
+      PUSH_BUFFER (engine->arena, size);
+      for (unsigned i = 0; i < size; i++)
+	PUSH_BUFFER (engine->arena, encode_literal (elits[i]));
+      const unsigned lit0 = encode_literal (elits[0]);
+      const unsigned lit1 = encode_literal (elits[1]);
+      const vwatch watch0 = {.blocking = lit1,.ref = ref };
+      const vwatch watch1 = {.blocking = lit0,.ref = ref };
+      PUSH_BUFFER (engine->watches[lit0], watch0);
+      PUSH_BUFFER (engine->watches[lit1], watch1);
+      if (size > 2)
+	PUSH_BUFFER (engine->candidates, ref);
+    }
+}
+
+static uint64_t
+hash_literals (size_t size, const unsigned *lits)
+{
+  uint64_t res = size;
+  for (size_t i = 0; i < size; i++)
+    {
+      uint64_t tmp = (lits[i] + 1) * (uint64_t) 11400714819323198485u;
+      res += tmp ^ (tmp >> 29);
+    }
+  return res;
+}
+
+static void
+queue_strengthened (vivifier * vivifier, unsigned glue, unsigned id,
+		    size_t size, const unsigned *lits)
+{
+  const uint64_t hash = hash_literals (size, lits);
+  uint64_t *const entry = vivifier->filter + (hash & (SIZE_FILTER - 1));
+  if (*entry == hash)
+    return;
+  *entry = hash;
+  vivifier->statistics.strengthened++;
+  pthread_mutex_lock (&vivifier->lock);
+  ibuffer *const results = &vivifier->results;
+  PUSH_BUFFER (*results, glue);
+  PUSH_BUFFER (*results, (int) id);
+  for (size_t i = 0; i < size; i++)
+    PUSH_BUFFER (*results, decode_literal (lits[i]));
+  PUSH_BUFFER (*results, 0);
+  pthread_mutex_unlock (&vivifier->lock);
+}
+
+// The negations of the literals of the candidate are assigned one after
+// the other.  Literals falsified by the previous ones are dropped.  If a
+// literal is satisfied or propagation yields a conflict the candidate is
+// implied by the literals kept so far.
+
+static void
+vivify_candidate (vivifier * vivifier, engine * engine, unsigned ref,
+		  size_t root)
+{
+  const unsigned *const arena = engine->arena.begin;
+  const unsigned glue = arena[ref];
+  const unsigned id = arena[ref + 1];
+  const unsigned size = arena[ref + 2];
+  const signed char *const values = engine->values;
+  ubuffer *const literals = &engine->literals;
+  literals->size = 0;
+  for (unsigned i = 0; i < size; i++)
+    {
+      const unsigned lit = arena[ref + 3 + i];
+      if (values[lit] > 0)
+	return;
+      PUSH_BUFFER (*literals, lit);
+    }
+  vivifier->statistics.vivified++;
+  ubuffer *const kept = &engine->kept;
+  kept->size = 0;
+  for (unsigned i = 0; i < size; i++)
+    {
+      const unsigned lit = literals->begin[i];
+      const signed char value = values[lit];
+      if (value < 0)
+	continue;
+      PUSH_BUFFER (*kept, lit);
+      if (value > 0)
+	break;
+      assign (engine, lit ^ 1);
+      if (!propagate (engine))
+	break;
+    }
+  backtrack (engine, root);
+  if (!kept->size || kept->size == size)
+    return;
+  const unsigned new_glue = MIN (glue, kept->size);
+  queue_strengthened (vivifier, new_glue, id, kept->size, kept->begin);
+}
+
+static void
+vivify_snapshot (vivifier * vivifier)
+{
+  engine *const engine = &vivifier->engine;
+  load_snapshot (vivifier, engine);
+  if (engine->inconsistent || !propagate (engine))
+    return;
+  const size_t root = engine->assigned;
+  const ubuffer *const candidates = &engine->candidates;
+  for (size_t i = 0; i < candidates->size; i++)
+    {
+      if (atomic_load_explicit (&vivifier->stop, memory_order_relaxed))
+	break;
+      vivify_candidate (vivifier, engine, candidates->begin[i], root);
+    }
+}
+
+static void *
+vivify_snapshots (void *ptr)
+{
+  vivifier *vivifier = ptr;
+  pthread_mutex_lock (&vivifier->lock);
+  for (;;)
+    {
+      while (!vivifier->ready && !atomic_load (&vivifier->stop))
+	pthread_cond_wait (&vivifier->wakeup, &vivifier->lock);
+      if (atomic_load (&vivifier->stop))
+	break;
+      vivifier->ready = false;
+      pthread_mutex_unlock (&vivifier->lock);
+      vivify_snapshot (vivifier);
+      pthread_mutex_lock (&vivifier->lock);
+      vivifier->busy = false;
+    }
+  pthread_mutex_unlock (&vivifier->lock);
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+kissat_init_vivifier (kissat * solver)
+{
+  assert (!solver->vivifier);
+  if (!GET_OPTION (vivifybackground))
+    return;
+  if (kissat_checking_or_proving (solver))
+    return;
+  vivifier *vivifier = kissat_calloc (solver, 1, sizeof *vivifier);
+  pthread_mutex_init (&vivifier->lock, 0);
+  pthread_cond_init (&vivifier->wakeup, 0);
+  atomic_init (&vivifier->stop, false);
+  vivifier->filter = kissat_calloc (solver, SIZE_FILTER, sizeof (uint64_t));
+  vivifier->next = GET_OPTION (vivifysnapshot);
+  if (pthread_create (&vivifier->thread, 0, vivify_snapshots, vivifier))
+    kissat_fatal ("failed to create background vivification thread");
+  solver->vivifier = vivifier;
+  kissat_very_verbose (solver, "vivifying in background thread");
+}
+
+void
+kissat_release_vivifier (kissat * solver)
+{
+  vivifier *vivifier = solver->vivifier;
+  if (!vivifier)
+    return;
+  pthread_mutex_lock (&vivifier->lock);
+  atomic_store (&vivifier->stop, true);
+  pthread_cond_signal (&vivifier->wakeup);
+  pthread_mutex_unlock (&vivifier->lock);
+  if (pthread_join (vivifier->thread, 0))
+    kissat_fatal ("failed to join background vivification thread");
+  kissat_verbose (solver, "vivified %" PRIu64 " clauses in %" PRIu64
+		  " snapshots in background and imported %" PRIu64
+		  " of %" PRIu64 " strengthened (%" PRIu64 " replaced)",
+		  vivifier->statistics.vivified,
+		  vivifier->statistics.snapshots,
+		  vivifier->statistics.imported,
+		  vivifier->statistics.strengthened,
+		  vivifier->statistics.replaced);
+  release_engine (&vivifier->engine);
+  free (vivifier->results.begin);
+  RELEASE_STACK (vivifier->imported);
+  RELEASE_STACK (vivifier->origins);
+  RELEASE_STACK (vivifier->snapshot);
+  kissat_dealloc (solver, vivifier->filter, SIZE_FILTER, sizeof (uint64_t));
+  pthread_cond_destroy (&vivifier->wakeup);
+  pthread_mutex_destroy (&vivifier->lock);
+  kissat_free (solver, vivifier, sizeof *vivifier);
+  solver->vivifier = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+// Clauses in the shared arena have no origin, since they are never
+// replaced, and strengthened versions are imported as redundant clauses.
+
+static void
+take_snapshot (kissat * solver, vivifier * vivifier)
+{
+  assert (solver->watching);
+  ints *const snapshot = &vivifier->snapshot;
+  CLEAR_STACK (*snapshot);
+  CLEAR_STACK (vivifier->origins);
+  vivifier->vars = SIZE_STACK (solver->import);
+  const value *const values = solver->values;
+  for (all_variables (idx))
+    {
+      const unsigned lit = LIT (idx);
+      const value value = values[lit];
+      if (!value)
+	continue;
+      const unsigned unit = value > 0 ? lit : NOT (lit);
+      const int elit = kissat_export_literal (solver, unit);
+      if (!elit)
+	continue;
+      PUSH_STACK (*snapshot, 0);
+      PUSH_STACK (*snapshot, elit);
+      PUSH_STACK (*snapshot, 0);
+    }
+  kissat_push_snapshot_binaries (solver, snapshot, true);
+  const unsigned tier2 = GET_OPTION (tier2);
+  for (all_clauses (c))
+    {
+      if (c->garbage)
+	continue;
+      if (c->redundant && c->glue > tier2)
+	continue;
+      const unsigned glue = c->redundant ? MAX (c->glue, 1) : 0;
+      const size_t offset = SIZE_STACK (*snapshot);
+      if (kissat_push_snapshot_clause (solver, snapshot, glue,
+				       c->size, c->lits) < 3 || c->redundant)
+	continue;
+      const origin origin = {
+	.offset = offset,
+	.ref = kissat_reference_clause (solver, c),
+	.size = c->size,
+	.hash = hash_literals (c->size, c->lits)
+      };
+      PUSH_STACK (vivifier->origins, origin);
+    }
+  kissat_push_snapshot_shared (solver, snapshot);
+  vivifier->statistics.snapshots++;
+  kissat_extremely_verbose (solver, "background vivification snapshot "
+			    "of %zu literals", SIZE_STACK (*snapshot));
+}
+
+// A strengthened irredundant clause replaces its origin if the latter is
+// still in the arena with the same literals and thus subsumed by the new
+// clause (which is checked explicitly since only hashes are compared).
+// Then the new clause is added as irredundant clause (which also traces it
+// in the proof) and the origin is deleted.
+
+static bool
+replace (kissat * solver, vivifier * vivifier, unsigned id,
+	 size_t size, const int *elits)
+{
+  assert (id < SIZE_STACK (vivifier->origins));
+  const origin *const origin = &PEEK_STACK (vivifier->origins, id);
+  if (origin->ref == INVALID_REF)
+    return false;
+  clause *c = kissat_dereference_clause (solver, origin->ref);
+  if (c->garbage || c->redundant || c->size != origin->size ||
+      hash_literals (c->size, c->lits) != origin->hash)
+    return false;
+  if (!kissat_import_external_literals (solver, size, elits))
+    return false;
+  for (all_literals_in_clause (lit, c))
+    MARK (lit) = 1;
+  bool subsumed = true;
+  for (all_stack (unsigned, lit, solver->clause))
+    if (!MARK (lit))
+      subsumed = false;
+  for (all_literals_in_clause (lit, c))
+    MARK (lit) = 0;
+  if (!subsumed)
+    {
+      CLEAR_STACK (solver->clause);
+      return false;
+    }
+  const size_t isize = SIZE_STACK (solver->clause);
+  unsigned *const ilits = BEGIN_STACK (solver->clause);
+  if (!isize)
+    solver->inconsistent = true;
+  else if (isize == 1)
+    kissat_learned_unit (solver, ilits[0]);
+  else if (isize == 2)
+    kissat_new_binary_clause (solver, false, ilits[0], ilits[1]);
+  else
+    (void) kissat_new_irredundant_clause (solver);
+  CLEAR_STACK (solver->clause);
+  c = kissat_dereference_clause (solver, origin->ref);
+  LOGCLS (c, "replaced by background vivification");
+  kissat_mark_clause_as_garbage (solver, c);
+  return true;
+}
+
+// Strengthened clauses without (valid) origin are imported as redundant
+// clauses, with glue one for irredundant ones, so that they are kept.
+
+static void
+import_strengthened (kissat * solver, vivifier * vivifier)
+{
+  const int *p = BEGIN_STACK (vivifier->imported);
+  const int *const end = END_STACK (vivifier->imported);
+  while (!solver->inconsistent && p != end)
+    {
+      const unsigned glue = *p++;
+      const int id = *p++;
+      const int *const elits = p;
+      while (*p)
+	p++;
+      const size_t size = p++ - elits;
+      if (!glue && id >= 0 && replace (solver, vivifier, id, size, elits))
+	vivifier->statistics.replaced++;
+      else if (kissat_import_external_clause (solver, MAX (glue, 1),
+					      size, elits))
+	vivifier->statistics.imported++;
+    }
+  CLEAR_STACK (vivifier->imported);
+}
+
+// Garbage collection moves clauses in the arena.  Then origins are found
+// again through the hash of their literals with a temporary hash table.
+
+void
+kissat_moved_vivifier_clauses (kissat * solver)
+{
+  vivifier *const vivifier = solver->vivifier;
+  if (!vivifier || EMPTY_STACK (vivifier->origins))
+    return;
+  const size_t size = SIZE_STACK (vivifier->origins);
+  size_t capacity = 1;
+  while (capacity < 2 * size)
+    capacity *= 2;
+  const size_t mask = capacity - 1;
+  unsigned *const table = kissat_nalloc (solver, capacity, sizeof *table);
+  memset (table, 0xff, capacity * sizeof *table);
+  origin *const origins = BEGIN_STACK (vivifier->origins);
+  for (unsigned id = 0; id < size; id++)
+    {
+      origin *const origin = origins + id;
+      size_t pos = origin->hash & mask;
+      while (table[pos] != UINT_MAX)
+	pos = (pos + 1) & mask;
+      table[pos] = id;
+      origin->ref = INVALID_REF;
+    }
+  for (all_clauses (c))
+    {
+      if (c->garbage || c->redundant)
+	continue;
+      const uint64_t hash = hash_literals (c->size, c->lits);
+      for (size_t pos = hash & mask; table[pos] != UINT_MAX;
+	   pos = (pos + 1) & mask)
+	{
+	  origin *const origin = origins + table[pos];
+	  if (origin->hash != hash || origin->size != c->size ||
+	      origin->ref != INVALID_REF)
+	    continue;
+	  origin->ref = kissat_reference_clause (solver, c);
+	  break;
+	}
+    }
+  kissat_dealloc (solver, table, capacity, sizeof *table);
+}
+
+int
+kissat_vivify_in_background (kissat * solver)
+{
+  vivifier *vivifier = solver->vivifier;
+  if (!vivifier)
+    return 0;
+  assert (!solver->level);
+  assert (!solver->inconsistent);
+  pthread_mutex_lock (&vivifier->lock);
+  const bool busy = vivifier->busy;
+  ibuffer *const results = &vivifier->results;
+  for (size_t i = 0; i < results->size; i++)
+    PUSH_STACK (vivifier->imported, results->begin[i]);
+  results->size = 0;
+  pthread_mutex_unlock (&vivifier->lock);
+  import_strengthened (solver, vivifier);
+  if (!solver->inconsistent && !busy && vivifier->next <= CONFLICTS)
+    {
+      take_snapshot (solver, vivifier);
+      vivifier->next = CONFLICTS + GET_OPTION (vivifysnapshot);
+      pthread_mutex_lock (&vivifier->lock);
+      vivifier->ready = vivifier->busy = true;
+      pthread_cond_signal (&vivifier->wakeup);
+      pthread_mutex_unlock (&vivifier->lock);
+    }
+  return solver->inconsistent ? 20 : 0;
+}
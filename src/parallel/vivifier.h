@@ -0,0 +1,26 @@
+#ifndef _vivifier_h_INCLUDED
+#define _vivifier_h_INCLUDED
+
+struct kissat;
+
+// Vivification in a background thread concurrent with search (enabled by
+// '--vivifybackground', which replaces vivification during probing).  At
+// restarts the search thread takes a snapshot of all irredundant clauses,
+// redundant binary and tier2 clauses and root-level units (as external
+// literals) if the helper thread is idle and enough conflicts passed since
+// the last snapshot.  The helper then vivifies the large clauses of the
+// snapshot with its own watches and trail, i.e., it propagates the
+// negation of their literals one after the other until a conflict occurs
+// or a literal becomes satisfied.  Strengthened clauses are queued and
+// imported by the search thread at the next restart.  A strengthened
+// irredundant clause replaces the original clause if that one is still
+// unchanged in the arena, otherwise it is imported as redundant clause.
+// Garbage collection moves clauses and thus has to tell the vivifier.
+
+void kissat_init_vivifier (struct kissat *);
+void kissat_release_vivifier (struct kissat *);
+
+int kissat_vivify_in_background (struct kissat *);
+void kissat_moved_vivifier_clauses (struct kissat *);
+
+#endif
@@ -0,0 +1,534 @@
+#include "walkers.h"
+#include "buffer.h"
+#include "snapshot.h"
+
+#include "allocate.h"
+#include "error.h"
+#include "inline.h"
+#include "print.h"
+#include "random.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Walkers check for a new snapshot or termination after this many flips
+// and publish improved assignments at most once per interval (except for
+// satisfying assignments), since publishing copies all values.
+
+#define CHECK_INTERVAL (1u << 10)
+#define PUBLISH_INTERVAL (1u << 12)
+
+typedef struct flipper flipper;
+typedef struct walkers walkers;
+
+// Literals of a walker are encoded as '2*idx + sign' of the external
+// literal and clauses as well as occurrences are kept in flat arrays, which
+// walker threads allocate themselves (see 'buffer.h').
+
+struct flipper
+{
+  pthread_t thread;
+  walkers *walkers;
+  unsigned id;
+  generator random;
+  uint64_t generation;		// Generation of loaded snapshot.
+  unsigned lits;		// Encoded literals.
+  unsigned clauses;		// Clauses in snapshot.
+  unsigned *literals;		// Literals of all clauses.
+  unsigned *starts;		// Start of clauses in 'literals'.
+  unsigned *offsets;		// Start of occurrences of literals.
+  unsigned *occurrences;	// Clauses in which literals occur.
+  unsigned *counts;		// Satisfied literals per clause.
+  unsigned *positions;		// Position of clauses in 'unsat'.
+  unsigned *unsat;		// Unsatisfied clauses.
+  unsigned current;		// Size of 'unsat'.
+  signed char *values;		// Values of literals.
+  double *scores;		// Scores of literals in picked clause.
+  double *table;		// Scores of break values.
+  unsigned exponents;		// Size of 'table'.
+  double epsilon;		// Score beyond table.
+  uint64_t flips;
+};
+
+struct walkers
+{
+  pthread_mutex_t lock;
+  pthread_cond_t wakeup;
+  unsigned size;		// Number of walker threads.
+  flipper *flippers;
+  _Atomic (bool) stop;		// Walkers asked to terminate.
+  _Atomic (uint64_t) generation;	// Of current snapshot (locked).
+  _Atomic (unsigned) minimum;	// Unsatisfied clauses of 'best' (locked).
+  unsigned vars;		// External variables plus one (locked).
+  ints snapshot;		// Clauses '0 lits... 0' (locked).
+  signed char *phases;		// Initial phases of walkers (locked).
+  signed char *best;		// Published assignment (locked).
+  struct
+  {
+    uint64_t snapshots;
+    uint64_t published;
+    uint64_t pulled;
+  } statistics;
+};
+
+/*------------------------------------------------------------------------*/
+
+// Same interpolation of the ProbSAT 'cb' base over the average clause
+// size as in 'walk.c'.
+
+static double cbvals[][2] = {
+  {0.0, 2.00},
+  {3.0, 2.50},
+  {4.0, 2.85},
+  {5.0, 3.70},
+  {6.0, 5.10},
+  {7.0, 7.40}
+};
+
+static double
+fit_cbval (double size)
+{
+  const size_t num_cbvals = sizeof cbvals / sizeof *cbvals;
+  size_t i = 0;
+  while (i + 2 < num_cbvals
+	 && (cbvals[i][0] > size || cbvals[i + 1][0] < size))
+    i++;
+  const double x2 = cbvals[i + 1][0], x1 = cbvals[i][0];
+  const double y2 = cbvals[i + 1][1], y1 = cbvals[i][1];
+  const double dx = x2 - x1, dy = y2 - y1;
+  assert (dx);
+  return dy * (size - x1) / dx + y1;
+}
+
+static void
+init_score_table (flipper * flipper, double cb)
+{
+  const double base = 1 / cb;
+  unsigned exponents = 0;
+  for (double next = 1; next; next *= base)
+    exponents++;
+  REALLOCATE_BUFFER (flipper->table, exponents);
+  unsigned i = 0;
+  double epsilon = 1;
+  for (double next = 1; next; next = epsilon * base)
+    flipper->table[i++] = epsilon = next;
+  assert (i == exponents);
+  flipper->exponents = exponents;
+  flipper->epsilon = epsilon;
+}
+
+static void
+push_unsat (flipper * flipper, unsigned clause)
+{
+  flipper->positions[clause] = flipper->current;
+  flipper->unsat[flipper->current++] = clause;
+}
+
+static void
+pop_unsat (flipper * flipper, unsigned clause)
+{
+  const unsigned pos = flipper->positions[clause];
+  const unsigned last = flipper->unsat[--flipper->current];
+  flipper->unsat[pos] = last;
+  flipper->positions[last] = pos;
+}
+
+// Called with the lock held, since the snapshot might be replaced.
+
+static void
+load_snapshot (flipper * flipper)
+{
+  walkers *const walkers = flipper->walkers;
+  const int *const begin = BEGIN_STACK (walkers->snapshot);
+  const int *const end = END_STACK (walkers->snapshot);
+  const unsigned vars = walkers->vars;
+  const unsigned lits = 2 * vars;
+
+  unsigned clauses = 0, max_size = 0;
+  size_t size_literals = 0;
+  for (const int *p = begin; p != end; p++)
+    {
+      const int *const q = ++p;
+      while (*p)
+	p++;
+      const unsigned size = p - q;
+      if (size > max_size)
+	max_size = size;
+      size_literals += size;
+      clauses++;
+    }
+
+  flipper->lits = lits;
+  flipper->clauses = clauses;
+  REALLOCATE_BUFFER (flipper->literals, size_literals);
+  REALLOCATE_BUFFER (flipper->starts, clauses + 1);
+  REALLOCATE_BUFFER (flipper->offsets, lits + 1);
+  REALLOCATE_BUFFER (flipper->occurrences, size_literals);
+  REALLOCATE_BUFFER (flipper->counts, clauses);
+  REALLOCATE_BUFFER (flipper->positions, clauses);
+  REALLOCATE_BUFFER (flipper->unsat, clauses);
+  REALLOCATE_BUFFER (flipper->values, lits);
+  REALLOCATE_BUFFER (flipper->scores, max_size);
+
+  unsigned *const literals = flipper->literals;
+  unsigned *const starts = flipper->starts;
+  unsigned *const offsets = flipper->offsets;
+  memset (offsets, 0, (lits + 1) * sizeof (unsigned));
+  unsigned clause = 0, *q = literals;
+  starts[0] = 0;
+  for (const int *p = begin; p != end; p++)
+    {
+      for (p++; *p; p++)
+	{
+	  const int elit = *p;
+	  const unsigned lit = 2u * ABS (elit) + (elit < 0);
+	  offsets[lit]++;
+	  *q++ = lit;
+	}
+      starts[++clause] = q - literals;
+    }
+  assert (clause == clauses);
+  for (unsigned lit = 1; lit < lits; lit++)
+    offsets[lit] += offsets[lit - 1];
+  offsets[lits] = size_literals;
+  for (clause = 0; clause < clauses; clause++)
+    for (unsigned i = starts[clause]; i < starts[clause + 1]; i++)
+      flipper->occurrences[--offsets[literals[i]]] = clause;
+
+  signed char *const values = flipper->values;
+  const signed char *const phases = walkers->phases;
+  for (unsigned idx = 0; idx < vars; idx++)
+    {
+      signed char value = flipper->id ? 0 : phases[idx];
+      if (!value)
+	value = kissat_pick_bool (&flipper->random) ? 1 : -1;
+      values[2 * idx] = value;
+      values[2 * idx + 1] = -value;
+    }
+
+  flipper->current = 0;
+  for (clause = 0; clause < clauses; clause++)
+    {
+      unsigned count = 0;
+      for (unsigned i = starts[clause]; i < starts[clause + 1]; i++)
+	count += (values[literals[i]] > 0);
+      flipper->counts[clause] = count;
+      if (!count)
+	push_unsat (flipper, clause);
+    }
+
+  const double average = clauses ? size_literals / (double) clauses : 0;
+  init_score_table (flipper, (flipper->id & 1) ? 2.0 : fit_cbval (average));
+  flipper->generation = atomic_load (&walkers->generation);
+}
+
+static void
+release_flipper (flipper * flipper)
+{
+  free (flipper->literals);
+  free (flipper->starts);
+  free (flipper->offsets);
+  free (flipper->occurrences);
+  free (flipper->counts);
+  free (flipper->positions);
+  free (flipper->unsat);
+  free (flipper->values);
+  free (flipper->scores);
+  free (flipper->table);
+}
+
+/*------------------------------------------------------------------------*/
+
+static unsigned
+break_value (flipper * flipper, unsigned lit)
+{
+  const unsigned not_lit = lit ^ 1;
+  const unsigned *const occurrences = flipper->occurrences;
+  const unsigned *const counts = flipper->counts;
+  unsigned res = 0;
+  for (unsigned i = flipper->offsets[not_lit];
+       i < flipper->offsets[not_lit + 1]; i++)
+    res += (counts[occurrences[i]] == 1);
+  return res;
+}
+
+// As in 'pick_literal' of 'walk.c' the unsatisfied clauses are visited
+// round-robin and a literal is picked with probability proportional to
+// its score, which decreases exponentially with its break value.
+
+static unsigned
+pick_literal (flipper * flipper)
+{
+  const unsigned clause = flipper->unsat[flipper->flips % flipper->current];
+  const unsigned *const begin = flipper->literals + flipper->starts[clause];
+  const unsigned *const end = flipper->literals + flipper->starts[clause + 1];
+  double *const scores = flipper->scores;
+  double sum = 0;
+  for (const unsigned *p = begin; p != end; p++)
+    {
+      const unsigned breaks = break_value (flipper, *p);
+      const double score = breaks < flipper->exponents ?
+	flipper->table[breaks] : flipper->epsilon;
+      scores[p - begin] = score;
+      sum += score;
+    }
+  const double threshold = sum * kissat_pick_double (&flipper->random);
+  unsigned res = end[-1];
+  sum = 0;
+  for (const unsigned *p = begin; p != end; p++)
+    if (threshold < (sum += scores[p - begin]))
+      {
+	res = *p;
+	break;
+      }
+  return res;
+}
+
+static void
+flip_literal (flipper * flipper, unsigned lit)
+{
+  signed char *const values = flipper->values;
+  assert (values[lit] < 0);
+  values[lit] = 1;
+  values[lit ^ 1] = -1;
+  const unsigned *const occurrences = flipper->occurrences;
+  unsigned *const counts = flipper->counts;
+  for (unsigned i = flipper->offsets[lit]; i < flipper->offsets[lit + 1];
+       i++)
+    {
+      const unsigned clause = occurrences[i];
+      if (!counts[clause]++)
+	pop_unsat (flipper, clause);
+    }
+  const unsigned not_lit = lit ^ 1;
+  for (unsigned i = flipper->offsets[not_lit];
+       i < flipper->offsets[not_lit + 1]; i++)
+    {
+      const unsigned clause = occurrences[i];
+      assert (counts[clause]);
+      if (!--counts[clause])
+	push_unsat (flipper, clause);
+    }
+}
+
+static void
+publish_values (flipper * flipper)
+{
+  walkers *const walkers = flipper->walkers;
+  pthread_mutex_lock (&walkers->lock);
+  if (flipper->generation == atomic_load (&walkers->generation) &&
+      flipper->current < atomic_load (&walkers->minimum))
+    {
+      const signed char *const values = flipper->values;
+      signed char *const best = walkers->best;
+      const unsigned vars = walkers->vars;
+      for (unsigned idx = 1; idx < vars; idx++)
+	best[idx] = values[2 * idx];
+      atomic_store (&walkers->minimum, flipper->current);
+      walkers->statistics.published++;
+    }
+  pthread_mutex_unlock (&walkers->lock);
+}
+
+static bool
+interrupted (flipper * flipper)
+{
+  walkers *const walkers = flipper->walkers;
+  if (atomic_load_explicit (&walkers->stop, memory_order_relaxed))
+    return true;
+  return atomic_load_explicit (&walkers->generation, memory_order_relaxed)
+    != flipper->generation;
+}
+
+// Flips until all clauses are satisfied, a new snapshot is available or
+// the walkers are stopped.
+
+static void
+walk_snapshot (flipper * flipper)
+{
+  walkers *const walkers = flipper->walkers;
+  uint64_t publish = flipper->flips;
+  for (;;)
+    {
+      if (flipper->current <
+	  atomic_load_explicit (&walkers->minimum, memory_order_relaxed) &&
+	  (!flipper->current || flipper->flips >= publish))
+	{
+	  publish_values (flipper);
+	  publish = flipper->flips + PUBLISH_INTERVAL;
+	}
+      if (!flipper->current)
+	break;
+      if (!(flipper->flips % CHECK_INTERVAL) && interrupted (flipper))
+	break;
+      flip_literal (flipper, pick_literal (flipper));
+      flipper->flips++;
+    }
+}
+
+static void *
+walk_snapshots (void *ptr)
+{
+  flipper *flipper = ptr;
+  walkers *const walkers = flipper->walkers;
+  pthread_mutex_lock (&walkers->lock);
+  for (;;)
+    {
+      while (atomic_load (&walkers->generation) == flipper->generation &&
+	     !atomic_load (&walkers->stop))
+	pthread_cond_wait (&walkers->wakeup, &walkers->lock);
+      if (atomic_load (&walkers->stop))
+	break;
+      load_snapshot (flipper);
+      pthread_mutex_unlock (&walkers->lock);
+      walk_snapshot (flipper);
+      pthread_mutex_lock (&walkers->lock);
+    }
+  pthread_mutex_unlock (&walkers->lock);
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+// Called with the lock held.  The saved phases become the initial phases
+// of the first walker, which thus continues from the pulled assignment.
+
+static void
+take_snapshot (kissat * solver, walkers * walkers)
+{
+  assert (solver->watching);
+  const unsigned vars = SIZE_STACK (solver->import);
+  if (vars != walkers->vars)
+    {
+      walkers->phases = kissat_nrealloc (solver, walkers->phases,
+					 walkers->vars, vars, 1);
+      walkers->best = kissat_nrealloc (solver, walkers->best,
+				       walkers->vars, vars, 1);
+      walkers->vars = vars;
+    }
+  memset (walkers->phases, 0, vars);
+  const value *const saved = solver->phases.saved;
+  for (all_variables (idx))
+    {
+      const int elit = kissat_export_literal (solver, LIT (idx));
+      if (elit)
+	walkers->phases[ABS (elit)] = elit < 0 ? -saved[idx] : saved[idx];
+    }
+  ints *const snapshot = &walkers->snapshot;
+  CLEAR_STACK (*snapshot);
+  kissat_push_snapshot_binaries (solver, snapshot, false);
+  for (all_clauses (c))
+    if (!c->garbage && !c->redundant)
+      kissat_push_snapshot_clause (solver, snapshot, 0, c->size, c->lits);
+  kissat_push_snapshot_shared (solver, snapshot);
+  atomic_store (&walkers->minimum, UINT_MAX);
+  atomic_fetch_add (&walkers->generation, 1);
+  walkers->statistics.snapshots++;
+  kissat_extremely_verbose (solver, "local search snapshot of %zu literals",
+			    SIZE_STACK (*snapshot));
+}
+
+void
+kissat_init_walkers (kissat * solver)
+{
+  assert (!solver->walkers);
+  const unsigned size = GET_OPTION (walkthreads);
+  if (!size)
+    return;
+  walkers *walkers = kissat_calloc (solver, 1, sizeof *walkers);
+  pthread_mutex_init (&walkers->lock, 0);
+  pthread_cond_init (&walkers->wakeup, 0);
+  atomic_init (&walkers->stop, false);
+  atomic_init (&walkers->generation, 0);
+  atomic_init (&walkers->minimum, UINT_MAX);
+  take_snapshot (solver, walkers);
+  walkers->size = size;
+  walkers->flippers = kissat_calloc (solver, size, sizeof (flipper));
+  const uint64_t seed = GET_OPTION (seed);
+  for (unsigned i = 0; i < size; i++)
+    {
+      flipper *flipper = walkers->flippers + i;
+      flipper->walkers = walkers;
+      flipper->id = i;
+      flipper->random = seed + i * (uint64_t) 11400714819323198485u;
+    }
+  for (unsigned i = 0; i < size; i++)
+    if (pthread_create (&walkers->flippers[i].thread, 0, walk_snapshots,
+			walkers->flippers + i))
+      kissat_fatal ("failed to create local search thread %u", i);
+  solver->walkers = walkers;
+  kissat_very_verbose (solver, "walking in %u background threads", size);
+}
+
+void
+kissat_release_walkers (kissat * solver)
+{
+  walkers *walkers = solver->walkers;
+  if (!walkers)
+    return;
+  pthread_mutex_lock (&walkers->lock);
+  atomic_store (&walkers->stop, true);
+  pthread_cond_broadcast (&walkers->wakeup);
+  pthread_mutex_unlock (&walkers->lock);
+  const unsigned size = walkers->size;
+  uint64_t flips = 0;
+  for (unsigned i = 0; i < size; i++)
+    {
+      flipper *flipper = walkers->flippers + i;
+      if (pthread_join (flipper->thread, 0))
+	kissat_fatal ("failed to join local search thread %u", i);
+      flips += flipper->flips;
+      release_flipper (flipper);
+    }
+  kissat_verbose (solver, "%u local search threads flipped %" PRIu64
+		  " literals in %" PRIu64 " snapshots and published %"
+		  PRIu64 " assignments (%" PRIu64 " pulled)", size, flips,
+		  walkers->statistics.snapshots,
+		  walkers->statistics.published,
+		  walkers->statistics.pulled);
+  kissat_dealloc (solver, walkers->flippers, size, sizeof (flipper));
+  kissat_dealloc (solver, walkers->phases, walkers->vars, 1);
+  kissat_dealloc (solver, walkers->best, walkers->vars, 1);
+  RELEASE_STACK (walkers->snapshot);
+  pthread_cond_destroy (&walkers->wakeup);
+  pthread_mutex_destroy (&walkers->lock);
+  kissat_free (solver, walkers, sizeof *walkers);
+  solver->walkers = 0;
+}
+
+bool
+kissat_pull_walkers (kissat * solver)
+{
+  walkers *walkers = solver->walkers;
+  assert (walkers);
+  assert (!solver->level);
+  pthread_mutex_lock (&walkers->lock);
+  const unsigned minimum = atomic_load (&walkers->minimum);
+  const bool pulled = (minimum != UINT_MAX);
+  if (pulled)
+    {
+      const signed char *const best = walkers->best;
+      value *const saved = solver->phases.saved;
+      for (all_variables (idx))
+	{
+	  const int elit = kissat_export_literal (solver, LIT (idx));
+	  if (!elit || !best[ABS (elit)])
+	    continue;
+	  const value value = best[ABS (elit)];
+	  saved[idx] = elit < 0 ? -value : value;
+	}
+      walkers->statistics.pulled++;
+    }
+  take_snapshot (solver, walkers);
+  pthread_cond_broadcast (&walkers->wakeup);
+  pthread_mutex_unlock (&walkers->lock);
+  if (pulled)
+    kissat_very_verbose (solver, "pulled phases from local search threads "
+			 "with %u unsatisfied clauses", minimum);
+  else
+    kissat_very_verbose (solver, "no phases from local search threads");
+  return pulled;
+}
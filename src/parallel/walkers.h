@@ -0,0 +1,21 @@
+#ifndef _walkers_h_INCLUDED
+#define _walkers_h_INCLUDED
+
+#include <stdbool.h>
+
+struct kissat;
+
+// Pool of local search threads (enabled by '--walkthreads') running
+// ProbSAT concurrently with search instead of blocking it as 'kissat_walk'
+// does.  All walkers work on the same snapshot of the irredundant clauses
+// (in external literals) starting from the saved phases or at random with
+// different seeds and keep publishing the best assignment found so far.
+// When rephasing selects walking, the search thread pulls the published
+// assignment as saved phases and takes a new snapshot for the walkers.
+
+void kissat_init_walkers (struct kissat *);
+void kissat_release_walkers (struct kissat *);
+
+bool kissat_pull_walkers (struct kissat *);
+
+#endif
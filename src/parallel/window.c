@@ -0,0 +1,243 @@
+#include "window.h"
+#include "portfolio.h"
+#include "share.h"
+
+#include "allocate.h"
+#include "inline.h"
+#include "print.h"
+
+#include <inttypes.h>
+#include <mpi.h>
+#include <string.h>
+
+typedef struct window window;
+
+struct window
+{
+  MPI_Win win;			// Window of all ranks.
+  uint64_t *base;		// Our own window memory.
+  uint64_t *remote;		// Last window fetched from another rank.
+  uint64_t *seen;		// Version fetched last per rank.
+  size_t words;			// Size of a window in words.
+  unsigned vars;		// External variables plus one.
+  size_t units;			// Units in 'solver->units' published.
+  ints equivalences;		// Pairs of 'lit repr' to be published.
+  int next;			// Rank polled next.
+  struct
+  {
+    uint64_t fetched;
+    uint64_t polled;
+    uint64_t published;
+    uint64_t imported;
+  } statistics;
+};
+
+// The first word of a window is its version, which is incremented every
+// time new facts are published.  Then follows the fixed literal bitmap
+// and then the table of representatives (two 'int' per word).
+
+static size_t
+bitmap_words (unsigned vars)
+{
+  return (2 * (size_t) vars + 63) / 64;
+}
+
+static uint64_t *
+bitmap (uint64_t * base)
+{
+  return base + 1;
+}
+
+static int *
+representatives (window * window, uint64_t * base)
+{
+  return (int *) (base + 1 + bitmap_words (window->vars));
+}
+
+void
+kissat_init_window (kissat * solver)
+{
+  assert (!solver->window);
+  const int size = kissat_portfolio_size ();
+  if (size < 2)
+    return;
+  if (!GET_OPTION (sharefacts))
+    return;
+  if (kissat_checking_or_proving (solver))
+    return;
+  window *window = kissat_calloc (solver, 1, sizeof *window);
+  const unsigned vars = SIZE_STACK (solver->import);
+  window->vars = vars;
+  window->words = 1 + bitmap_words (vars) + (vars + 1) / 2;
+  const size_t bytes = window->words * sizeof (uint64_t);
+  MPI_Win_allocate (bytes, sizeof (uint64_t), MPI_INFO_NULL,
+		    MPI_COMM_WORLD, &window->base, &window->win);
+  const int rank = kissat_portfolio_rank ();
+  MPI_Win_lock (MPI_LOCK_EXCLUSIVE, rank, 0, window->win);
+  memset (window->base, 0, bytes);
+  MPI_Win_unlock (rank, window->win);
+  MPI_Barrier (MPI_COMM_WORLD);
+  window->remote = kissat_calloc (solver, window->words, sizeof (uint64_t));
+  window->seen = kissat_calloc (solver, size, sizeof (uint64_t));
+  window->next = (rank + 1) % size;
+  solver->window = window;
+  kissat_very_verbose (solver, "sharing facts through window of %zu bytes",
+		       bytes);
+}
+
+// Collective as 'MPI_Win_free' synchronizes all ranks.
+
+void
+kissat_release_window (kissat * solver)
+{
+  window *window = solver->window;
+  if (!window)
+    return;
+  kissat_verbose (solver, "published %" PRIu64 " and imported %" PRIu64
+		  " facts from %" PRIu64 " fetched windows (%" PRIu64
+		  " polled)", window->statistics.published,
+		  window->statistics.imported, window->statistics.fetched,
+		  window->statistics.polled);
+  MPI_Win_free (&window->win);
+  const int size = kissat_portfolio_size ();
+  kissat_dealloc (solver, window->seen, size, sizeof (uint64_t));
+  kissat_dealloc (solver, window->remote, window->words, sizeof (uint64_t));
+  RELEASE_STACK (window->equivalences);
+  kissat_free (solver, window, sizeof *window);
+  solver->window = 0;
+}
+
+void
+kissat_export_equivalence (kissat * solver, unsigned lit, unsigned repr)
+{
+  window *window = solver->window;
+  if (!window)
+    return;
+  const int elit = kissat_export_literal (solver, lit);
+  const int erepr = kissat_export_literal (solver, repr);
+  if (!elit || !erepr)
+    return;
+  PUSH_STACK (window->equivalences, elit);
+  PUSH_STACK (window->equivalences, erepr);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+publish_facts (kissat * solver, window * window)
+{
+  const size_t units = SIZE_STACK (solver->units);
+  if (window->units == units && EMPTY_STACK (window->equivalences))
+    return;
+  const int rank = kissat_portfolio_rank ();
+  MPI_Win_lock (MPI_LOCK_EXCLUSIVE, rank, 0, window->win);
+  uint64_t *const base = window->base;
+  uint64_t *const fixed = bitmap (base);
+  for (size_t i = window->units; i < units; i++)
+    {
+      const int elit = PEEK_STACK (solver->units, i);
+      const size_t pos = 2 * (size_t) ABS (elit) + (elit < 0);
+      assert (pos / 2 < window->vars);
+      fixed[pos / 64] |= (uint64_t) 1 << (pos % 64);
+    }
+  int *const repr = representatives (window, base);
+  const int *const end = END_STACK (window->equivalences);
+  for (const int *p = BEGIN_STACK (window->equivalences); p != end; p += 2)
+    {
+      const int elit = p[0], erepr = p[1];
+      assert ((unsigned) ABS (elit) < window->vars);
+      repr[ABS (elit)] = elit < 0 ? -erepr : erepr;
+    }
+  base[0]++;
+  MPI_Win_unlock (rank, window->win);
+  window->statistics.published += units - window->units;
+  window->statistics.published += SIZE_STACK (window->equivalences) / 2;
+  window->units = units;
+  CLEAR_STACK (window->equivalences);
+}
+
+// Facts we published ourselves are skipped.  Otherwise importing goes
+// through the same code as imported clauses, which ignores units already
+// fixed and equivalences of variables eliminated or substituted already.
+
+static void
+import_facts (kissat * solver, window * window)
+{
+  const uint64_t *const remote_fixed = bitmap (window->remote);
+  const uint64_t *const local_fixed = bitmap (window->base);
+  const size_t words = bitmap_words (window->vars);
+  for (size_t i = 0; !solver->inconsistent && i < words; i++)
+    {
+      uint64_t bits = remote_fixed[i] & ~local_fixed[i];
+      for (size_t pos = 64 * i; bits && !solver->inconsistent; pos++)
+	{
+	  const bool bit = bits & 1;
+	  bits >>= 1;
+	  if (!bit)
+	    continue;
+	  const int eidx = pos / 2;
+	  const int elit = (pos & 1) ? -eidx : eidx;
+	  if (kissat_import_external_clause (solver, 1, 1, &elit))
+	    window->statistics.imported++;
+	}
+    }
+  const int *const remote_repr = representatives (window, window->remote);
+  const int *const local_repr = representatives (window, window->base);
+  for (unsigned eidx = 1; !solver->inconsistent && eidx < window->vars;
+       eidx++)
+    {
+      const int erepr = remote_repr[eidx];
+      if (!erepr || erepr == local_repr[eidx])
+	continue;
+      const int elit = eidx;
+      const int first[2] = { -elit, erepr };
+      const int second[2] = { elit, -erepr };
+      bool imported = kissat_import_external_clause (solver, 1, 2, first);
+      if (!solver->inconsistent &&
+	  kissat_import_external_clause (solver, 1, 2, second))
+	imported = true;
+      if (imported)
+	window->statistics.imported++;
+    }
+}
+
+static void
+poll_window (kissat * solver, window * window)
+{
+  const int size = kissat_portfolio_size ();
+  const int rank = kissat_portfolio_rank ();
+  const int target = window->next;
+  assert (target != rank);
+  window->next = (target + 1) % size;
+  if (window->next == rank)
+    window->next = (rank + 1) % size;
+  window->statistics.polled++;
+  uint64_t version;
+  MPI_Win_lock (MPI_LOCK_SHARED, target, 0, window->win);
+  MPI_Get (&version, 1, MPI_UINT64_T, target, 0, 1, MPI_UINT64_T,
+	   window->win);
+  MPI_Win_flush (target, window->win);
+  const bool changed = (version != window->seen[target]);
+  if (changed)
+    MPI_Get (window->remote, window->words, MPI_UINT64_T, target,
+	     0, window->words, MPI_UINT64_T, window->win);
+  MPI_Win_unlock (target, window->win);
+  if (!changed)
+    return;
+  window->seen[target] = version;
+  window->statistics.fetched++;
+  import_facts (solver, window);
+}
+
+int
+kissat_share_facts (kissat * solver)
+{
+  window *window = solver->window;
+  if (!window)
+    return 0;
+  assert (!solver->level);
+  assert (!solver->inconsistent);
+  publish_facts (solver, window);
+  poll_window (solver, window);
+  return solver->inconsistent ? 20 : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef _window_h_INCLUDED
+#define _window_h_INCLUDED
+
+struct kissat;
+
+// Root-level units and equivalent literals are shared between ranks
+// through MPI one-sided communication instead of messages.  Every rank
+// exposes an MPI window holding a version counter, a bitmap with two bits
+// per external variable (fixed to true or fixed to false) and a table of
+// representative external literals for substituted variables.  At
+// restarts a rank first publishes new units (from 'solver->units') and
+// equivalences (recorded during substitution, which also covers those
+// found by sweeping) in its own window.  Then it reads the version of the
+// window of the next other rank (round-robin) and only if it changed
+// fetches and imports the rest of it.  Imported equivalences are added as
+// two binary clauses and substituted locally later on.
+
+void kissat_init_window (struct kissat *);
+void kissat_release_window (struct kissat *);
+
+void kissat_export_equivalence (struct kissat *, unsigned lit,
+				unsigned repr);
+int kissat_share_facts (struct kissat *);
+
+#endif
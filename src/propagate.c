@@ -1,5 +1,9 @@
 // so the propagate step is to propagate literal in the hope that we can find a conflict clause as fast as possible.
 
+#include "counters.h"
+#include "replacement.h"
+#include "ternary.h"
+
 // this is the "main" function of this step
 clause *
 kissat_search_propagate (kissat * solver)
@@ -57,8 +61,7 @@ PROPAGATE_LITERAL (kissat * solver,
   watch *const begin_watches = BEGIN_WATCHES (*watches);
   const watch *const end_watches = END_WATCHES (*watches);
 
-  watch *q = begin_watches;
-  const watch *p = q;
+  const watch *p = begin_watches;
 
   unsigneds *const delayed = &solver->delayed;
   assert (EMPTY_STACK (*delayed));
@@ -68,135 +71,481 @@ PROPAGATE_LITERAL (kissat * solver,
   const unsigned idx = IDX (lit);
   struct assigned *const a = assigned + idx;
   const bool probing = solver->probing;
+  const bool simd = solver->simd_replacement;
   const unsigned level = a->level;
   clause *res = 0;
 
+  // Binary watches are kept in front of large watches while watching and
+  // counted (see 'kissat_push_binary_watch' in 'inline.h').  Thus all
+  // binary clauses are propagated before the first large clause is
+  // visited, and the loop over binary watches does not need to check the
+  // watch type, nor to copy watches, since binary watches are never
+  // removed during propagation.
+
+  assert (kissat_binary_watches_counted (solver, not_lit));
+  const watch *const end_binaries = p + solver->binaries[not_lit];
+
+  while (p != end_binaries)
+    {
+      const watch watch = *p++;
+      const unsigned other = watch.binary.lit;
+      assert (VALID_INTERNAL_LITERAL (other));
+      const value other_value = values[other];
+      if (other_value > 0)
+	continue;
+      const bool redundant = watch.binary.redundant;
+      if (other_value < 0)
+	{
+	  res = kissat_binary_conflict (solver, redundant, not_lit, other);
+#ifndef CONTINUE_PROPAGATING_AFTER_CONFLICT
+	  break;
+#endif
+	}
+      else
+	{
+	  kissat_fast_binary_assign (solver, probing, level,
+				     values, assigned,
+				     redundant, other, not_lit);
+	  ticks++;
+	}
+    }
+
+  // Counted or ternary clauses are propagated next and their regular
+  // watches, tagged with 'separate', are skipped in the loop over large
+  // watches below.  Only root-level units still move them as usual, since
+  // garbage collection drops watches of root-level falsified literals and
+  // expects the other clauses with such a watched literal to be satisfied.
+
+#ifdef CONTINUE_PROPAGATING_AFTER_CONFLICT
+  if (solver->counters)
+#else
+  if (!res && solver->counters)
+#endif
+    {
+      clause *const conflict = propagate_counted_literal (solver,
+#if defined(PROBING_PROPAGATION)
+							  ignore,
+#endif
+							  lit);
+      if (conflict)
+	res = conflict;
+    }
+
+#ifdef CONTINUE_PROPAGATING_AFTER_CONFLICT
+  if (solver->ternary)
+#else
+  if (!res && solver->ternary)
+#endif
+    {
+      clause *const conflict = propagate_ternary_literal (solver,
+#if defined(PROBING_PROPAGATION)
+							  ignore,
+#endif
+							  not_lit);
+      if (conflict)
+	res = conflict;
+    }
+
+  // The clauses of the next 'lookahead' large watches with a non-true
+  // blocking literal are prefetched while the current one is processed
+  // (see 'prefetch_large_watches' below).
+
+  const unsigned lookahead = GET_OPTION (prefetch);
+  const watch *prefetched = p;
+  unsigned pending = 0;
+
+  watch *q = (watch *) p;
+
+#ifdef CONTINUE_PROPAGATING_AFTER_CONFLICT
   while (p != end_watches)
+#else
+  while (!res && p != end_watches)
+#endif
     {
       const watch head = *q++ = *p++;
+      assert (!head.type.binary);
+      const watch tail = *q++ = *p++;
+      if (head.blocking.separate && level)
+	continue;
       const unsigned blocking = head.blocking.lit;
       assert (VALID_INTERNAL_LITERAL (blocking));
       const value blocking_value = values[blocking];
-      const bool binary = head.type.binary;
-      watch tail;
-      if (!binary)
-	tail = *q++ = *p++;
       if (blocking_value > 0)
 	continue;
-      if (binary)
+      if (lookahead)
+	prefetched = prefetch_large_watches (values, arena, p, prefetched,
+					     end_watches, lookahead,
+					     &pending);
+      const reference ref = tail.raw;
+      assert (ref < SIZE_STACK (solver->arena));
+      clause *const c = (clause *) (arena + ref);
+#if defined(PROBING_PROPAGATION)
+      if (c == ignore)
+	continue;
+#endif
+      ticks++;
+      if (c->garbage)
 	{
-	  const bool redundant = head.binary.redundant;
-	  if (blocking_value < 0)
-	    {
-	      res = kissat_binary_conflict (solver, redundant,
-					    not_lit, blocking);
+	  q -= 2;
+	  continue;
+	}
+      unsigned *const lits = BEGIN_LITS (c);
+      const unsigned other = lits[0] ^ lits[1] ^ not_lit;
+      assert (lits[0] != lits[1]);
+      assert (VALID_INTERNAL_LITERAL (other));
+      assert (not_lit != other);
+      assert (lit != other);
+      const value other_value = values[other];
+      if (other_value > 0)
+	{
+	  q[-2].blocking.lit = other;
+	  continue;
+	}
+      const unsigned *const end_lits = lits + c->size;
+      unsigned *const searched = lits + c->searched;
+      assert (c->lits + 2 <= searched);
+      assert (searched < end_lits);
+      unsigned *r =
+	kissat_find_replacement (simd, values, searched, end_lits);
+      if (r == end_lits)
+	{
+	  r = kissat_find_replacement (simd, values, lits + 2, searched);
+	  if (r == searched)
+	    r = 0;
+	}
+
+      if (r)
+	{
+	  c->searched = r - lits;
+	  const unsigned replacement = *r;
+	  assert (VALID_INTERNAL_LITERAL (replacement));
+	  assert (values[replacement] >= 0);
+	  LOGREF (ref, "unwatching %s in", LOGLIT (not_lit));
+	  q -= 2;
+	  lits[0] = other;
+	  lits[1] = replacement;
+	  assert (lits[0] != lits[1]);
+	  *r = not_lit;
+	  kissat_delay_watching_large (solver, delayed,
+				       replacement, other, ref);
+	  ticks++;
+	}
+      else if (other_value)
+	{
+	  assert (blocking_value < 0);
+	  assert (other_value < 0);
+	  LOGREF (ref, "conflicting");
+	  res = c;
 #ifndef CONTINUE_PROPAGATING_AFTER_CONFLICT
-	      break;
+	  break;
 #endif
-	    }
-	  else
+	}
+      else
+	{
+	  kissat_fast_assign_reference (solver, values,
+					assigned, other, ref, c);
+	  ticks++;
+	}
+    }
+  solver->ticks += ticks;
+
+  while (p != end_watches)
+    *q++ = *p++;
+  SET_END_OF_WATCHES (*watches, q);
+
+  kissat_watch_large_delayed (solver, all_watches, delayed);
+
+  if (!res && solver->shared)
+    res = propagate_shared_literal (solver, not_lit);
+
+  return res;
+}
+
+// Large clauses are dereferenced right after checking the blocking
+// literal, which on large instances mostly misses the cache.  Thus the
+// watches after the current one are scanned ahead and the clauses of those
+// with a non-true blocking literal are prefetched until 'lookahead' of
+// them are in flight.  The visited clause consumes one of these.  Since
+// propagation only appends to other watch lists, the remaining watches
+// starting at 'p' do not change, but blocking literals might become true
+// in the meantime, which only makes this count approximate.
+
+static inline const watch *
+prefetch_large_watches (const value * values, const ward * arena,
+			const watch * p, const watch * prefetched,
+			const watch * end_watches, unsigned lookahead,
+			unsigned *pending)
+{
+  if (prefetched < p)
+    {
+      prefetched = p;
+      *pending = 0;
+    }
+  else if (*pending)
+    *pending -= 1;
+  while (*pending < lookahead && prefetched != end_watches)
+    {
+      const watch head = *prefetched++;
+      const watch tail = *prefetched++;
+      if (head.blocking.separate)
+	continue;
+      if (values[head.blocking.lit] > 0)
+	continue;
+      __builtin_prefetch (arena + tail.raw, 0, 1);
+      *pending += 1;
+    }
+  return prefetched;
+}
+
+// Same as above for clauses in the shared arena (see 'parallel/shared.h'),
+// except that the watched literals are taken from the private state of
+// the clause instead of its first two literals, which are never swapped.
+// The replacement search wraps around starting at 'searched' and has to
+// skip the other watched literal explicitly.
+
+static inline clause *
+propagate_shared_literal (kissat * solver, const unsigned not_lit)
+{
+  shared_clauses *const shared = solver->shared;
+  const shared_arena *const arena = shared->arena;
+  shared_state *const states = shared->states;
+  shared_watches *const all_watches = shared->watches;
+  shared_watches *const watches = all_watches + not_lit;
+  assigned *const assigned = solver->assigned;
+  value *const values = solver->values;
+
+  shared_watch *q = BEGIN_STACK (*watches);
+  const shared_watch *const end_watches = END_STACK (*watches);
+  const shared_watch *p = q;
+
+  const size_t words = sizeof (shared_watch) / sizeof (unsigned);
+  const size_t size_watches = words * SIZE_STACK (*watches);
+  uint64_t ticks = kissat_cache_lines (size_watches, sizeof (unsigned));
+  clause *res = 0;
+
+  while (p != end_watches)
+    {
+      const shared_watch watch = *q++ = *p++;
+      if (values[watch.blocking] > 0)
+	continue;
+      ticks++;
+      const unsigned idx = watch.idx;
+      shared_state *const state = states + idx;
+      const unsigned other = state->watched[0] ^ state->watched[1] ^ not_lit;
+      assert (VALID_INTERNAL_LITERAL (other));
+      const value other_value = values[other];
+      if (other_value > 0)
+	{
+	  q[-1].blocking = other;
+	  continue;
+	}
+      clause *const c = kissat_shared_clause (arena, idx);
+      const unsigned *const lits = c->lits;
+      const unsigned size = c->size;
+      unsigned pos = state->searched, replacement = INVALID_LIT;
+      assert (pos < size);
+      for (unsigned i = 0; i != size; i++)
+	{
+	  const unsigned lit = lits[pos];
+	  if (lit != other && values[lit] >= 0)
 	    {
-	      assert (!blocking_value);
-	      kissat_fast_binary_assign (solver, probing, level,
-					 values, assigned,
-					 redundant, blocking, not_lit);
-	      ticks++;
+	      replacement = lit;
+	      break;
 	    }
+	  if (++pos == size)
+	    pos = 0;
+	}
+      if (replacement != INVALID_LIT)
+	{
+	  assert (replacement != not_lit);
+	  state->searched = pos;
+	  state->watched[0] = other;
+	  state->watched[1] = replacement;
+	  const shared_watch moved = {.blocking = other,.idx = idx };
+	  PUSH_STACK (all_watches[replacement], moved);
+	  q--;
+	  ticks++;
+	}
+      else if (other_value)
+	{
+	  LOG ("conflicting shared clause[%u]", idx);
+	  shared->conflict = idx;
+	  res = c;
+	  break;
 	}
       else
 	{
-	  const reference ref = tail.raw;
-	  assert (ref < SIZE_STACK (solver->arena));
-	  clause *const c = (clause *) (arena + ref);
+	  const unsigned level =
+	    kissat_assignment_level (solver, values, assigned, other, c);
+	  kissat_fast_assign (solver, solver->probing, level, values,
+			      assigned, false, false, other,
+			      SHARED_REFERENCE + idx);
+	  ticks++;
+	}
+    }
+  solver->ticks += ticks;
+
+  while (p != end_watches)
+    *q++ = *p++;
+  SET_END_OF_STACK (*watches, q);
+
+  return res;
+}
+
+// Ternary clauses are watched by all their literals in separate watch
+// lists, which keep the two other literals of the clause inline (see
+// 'ternary.h').  Thus watches never have to be moved, and the clause in
+// the arena is only accessed if it becomes a reason or is conflicting.
+// Only then garbage clauses are noticed and their watches dropped.
+
+static inline clause *
+propagate_ternary_literal (kissat * solver,
 #if defined(PROBING_PROPAGATION)
-	  if (c == ignore)
-	    continue;
+			   const clause * const ignore,
 #endif
-	  ticks++;
-	  if (c->garbage)
-	    {
-	      q -= 2;
-	      continue;
-	    }
-	  unsigned *const lits = BEGIN_LITS (c);
-	  const unsigned other = lits[0] ^ lits[1] ^ not_lit;
-	  assert (lits[0] != lits[1]);
-	  assert (VALID_INTERNAL_LITERAL (other));
-	  assert (not_lit != other);
-	  assert (lit != other);
-	  const value other_value = values[other];
-	  if (other_value > 0)
-	    {
-	      q[-2].blocking.lit = other;
-	      continue;
-	    }
-	  const unsigned *const end_lits = lits + c->size;
-	  unsigned *const searched = lits + c->searched;
-	  assert (c->lits + 2 <= searched);
-	  assert (searched < end_lits);
-	  unsigned *r, replacement = INVALID_LIT;
-	  value replacement_value = -1;
-	  for (r = searched; r != end_lits; r++)
-	    {
-	      replacement = *r;
-	      assert (VALID_INTERNAL_LITERAL (replacement));
-	      replacement_value = values[replacement];
-	      if (replacement_value >= 0)
-		break;
-	    }
-	  if (replacement_value < 0)
-	    {
-	      for (r = lits + 2; r != searched; r++)
-		{
-		  replacement = *r;
-		  assert (VALID_INTERNAL_LITERAL (replacement));
-		  replacement_value = values[replacement];
-		  if (replacement_value >= 0)
-		    break;
-		}
-	    }
+			   const unsigned not_lit)
+{
+  ternary_clauses *const ternary = solver->ternary;
+  if (not_lit >= ternary->size)
+    return 0;
+  ternary_watches *const watches = ternary->watches + not_lit;
+  ward *const arena = BEGIN_STACK (solver->arena);
+  assigned *const assigned = solver->assigned;
+  value *const values = solver->values;
 
-	  if (replacement_value >= 0)
-	    {
-	      c->searched = r - lits;
-	      assert (replacement != INVALID_LIT);
-	      LOGREF (ref, "unwatching %s in", LOGLIT (not_lit));
-	      q -= 2;
-	      lits[0] = other;
-	      lits[1] = replacement;
-	      assert (lits[0] != lits[1]);
-	      *r = not_lit;
-	      kissat_delay_watching_large (solver, delayed,
-					   replacement, other, ref);
-	      ticks++;
-	    }
-	  else if (other_value)
-	    {
-	      assert (replacement_value < 0);
-	      assert (blocking_value < 0);
-	      assert (other_value < 0);
-	      LOGREF (ref, "conflicting");
-	      res = c;
-#ifndef CONTINUE_PROPAGATING_AFTER_CONFLICT
-	      break;
+  ternary_watch *q = BEGIN_STACK (*watches);
+  const ternary_watch *const end_watches = END_STACK (*watches);
+  const ternary_watch *p = q;
+
+  const size_t words = sizeof (ternary_watch) / sizeof (unsigned);
+  const size_t size_watches = words * SIZE_STACK (*watches);
+  uint64_t ticks = kissat_cache_lines (size_watches, sizeof (unsigned));
+  clause *res = 0;
+
+  while (p != end_watches)
+    {
+      const ternary_watch watch = *q++ = *p++;
+      const unsigned first = watch.lits[0];
+      const unsigned second = watch.lits[1];
+      assert (VALID_INTERNAL_LITERAL (first));
+      assert (VALID_INTERNAL_LITERAL (second));
+      const value first_value = values[first];
+      if (first_value > 0)
+	continue;
+      const value second_value = values[second];
+      if (second_value > 0)
+	continue;
+      if (!first_value && !second_value)
+	continue;
+      const reference ref = watch.ref;
+      assert (ref < SIZE_STACK (solver->arena));
+      clause *const c = (clause *) (arena + ref);
+#if defined(PROBING_PROPAGATION)
+      if (c == ignore)
+	continue;
 #endif
-	    }
-	  else
-	    {
-	      assert (replacement_value < 0);
-	      kissat_fast_assign_reference (solver, values,
-					    assigned, other, ref, c);
-	      ticks++;
-	    }
+      ticks++;
+      if (c->garbage)
+	{
+	  q--;
+	  continue;
+	}
+      assert (kissat_ternary_clause (c));
+      if (first_value && second_value)
+	{
+	  LOGREF (ref, "conflicting ternary");
+	  res = c;
+	  break;
 	}
+      const unsigned other = first_value ? second : first;
+      kissat_fast_assign_reference (solver, values, assigned, other, ref, c);
     }
   solver->ticks += ticks;
 
   while (p != end_watches)
     *q++ = *p++;
-  SET_END_OF_WATCHES (*watches, q);
+  SET_END_OF_STACK (*watches, q);
 
-  kissat_watch_large_delayed (solver, all_watches, delayed);
+  return res;
+}
+
+// Propagating 'lit' decrements the counters of all clauses with 'not_lit'
+// (see 'counters.h').  All counters have to be updated even after a
+// conflict is found, since backtracking undoes all of them.  The clause is
+// only accessed if its remaining literal is not true.  Then clauses which
+// are garbage or were shrunken in the meantime are noticed and their
+// counters dropped.
+
+static inline clause *
+propagate_counted_literal (kissat * solver,
+#if defined(PROBING_PROPAGATION)
+			   const clause * const ignore,
+#endif
+			   const unsigned lit)
+{
+  counted_clauses *const counters = solver->counters;
+  const unsigned idx = IDX (lit);
+  if (idx >= counters->size)
+    return 0;
+  bool *const counted = counters->counted + idx;
+  if (*counted)
+    return 0;
+  *counted = true;
+  const unsigned not_lit = NOT (lit);
+  const unsigneds *const occurrences = counters->occurrences + not_lit;
+  clause_counter *const all = BEGIN_STACK (counters->counters);
+  ward *const arena = BEGIN_STACK (solver->arena);
+  assigned *const assigned = solver->assigned;
+  value *const values = solver->values;
+
+  const size_t size_occurrences = SIZE_STACK (*occurrences);
+  uint64_t ticks = kissat_cache_lines (size_occurrences, sizeof (unsigned));
+  clause *res = 0;
+
+  for (all_stack (unsigned, pos, *occurrences))
+    {
+      clause_counter *const counter = all + pos;
+      assert (counter->count);
+      const unsigned count = --counter->count;
+      counter->sum -= not_lit;
+      ticks++;
+      if (count > 1)
+	continue;
+      if (res)
+	continue;
+      if (counter->dead)
+	continue;
+      const unsigned other = counter->sum;
+      const value other_value = count ? values[other] : -1;
+      if (other_value > 0)
+	continue;
+      const reference ref = counter->ref;
+      assert (ref < SIZE_STACK (solver->arena));
+      clause *const c = (clause *) (arena + ref);
+#if defined(PROBING_PROPAGATION)
+      if (c == ignore)
+	continue;
+#endif
+      ticks++;
+      if (c->garbage || !kissat_counted_clause (c))
+	{
+	  LOGREF (ref, "dropping counter of");
+	  counter->dead = true;
+	  continue;
+	}
+      if (other_value)
+	{
+	  LOGREF (ref, "conflicting counted");
+	  res = c;
+	}
+      else
+	{
+	  assert (VALID_INTERNAL_LITERAL (other));
+	  kissat_fast_assign_reference (solver, values,
+					assigned, other, ref, c);
+	}
+    }
+  solver->ticks += ticks;
 
   return res;
 }
@@ -0,0 +1,59 @@
+#include "replacement.h"
+
+unsigned *
+kissat_scalar_replacement (const signed char *values,
+			   unsigned *begin, unsigned *end)
+{
+  unsigned *p = begin;
+  while (p != end && values[*p] < 0)
+    p++;
+  return p;
+}
+
+#ifdef SIMD_REPLACEMENT
+
+#include <immintrin.h>
+
+bool
+kissat_simd_replacement_supported (void)
+{
+  return __builtin_cpu_supports ("avx2");
+}
+
+// There is no byte gather, thus the values of eight literals are gathered
+// as the aligned 32-bit words containing them (index 'lit / 4').  Each
+// word is then shifted left such that the value byte 'lit % 4' ends up in
+// the most significant byte, which puts the sign of the value into the
+// sign bit of the word.  Reading the whole aligned word containing a valid
+// byte of 'values' never crosses a page (nor a 'malloc' block) but might
+// read up to three bytes beyond the end of the array, which for instance
+// address sanitizers will complain about (compile with '-DNSIMD' then).
+
+__attribute__ ((target ("avx2"))) unsigned *
+kissat_simd_replacement (const signed char *values,
+			 unsigned *begin, unsigned *end)
+{
+  const int *const words = (const int *) values;
+  const __m256i three = _mm256_set1_epi32 (3);
+  unsigned *p = begin;
+  while (end - p >= 8)
+    {
+      const __m256i lits = _mm256_loadu_si256 ((const __m256i *) p);
+      const __m256i indices = _mm256_srli_epi32 (lits, 2);
+      const __m256i gathered = _mm256_i32gather_epi32 (words, indices, 4);
+      const __m256i bytes = _mm256_xor_si256 (_mm256_and_si256 (lits, three),
+					      three);
+      const __m256i shifts = _mm256_slli_epi32 (bytes, 3);
+      const __m256i shifted = _mm256_sllv_epi32 (gathered, shifts);
+      const int negative = _mm256_movemask_ps (_mm256_castsi256_ps (shifted));
+      const unsigned mask = ~(unsigned) negative & 0xff;
+      if (mask)
+	return p + __builtin_ctz (mask);
+      p += 8;
+    }
+  while (p != end && values[*p] < 0)
+    p++;
+  return p;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _replacement_h_INCLUDED
+#define _replacement_h_INCLUDED
+
+#include <stdbool.h>
+
+// Search for a replacement of a watched literal in a large clause during
+// propagation (see 'propagate.c'), that is the first literal in the range
+// '[begin, end)' which is not false, or 'end' if all literals are false.
+//
+// Long learned clauses (on cryptographic instances 30 to 100 literals)
+// make this search dominate propagation.  With '--simd' on x86 processors
+// supporting AVX2 ranges of at least 'SIMD_REPLACEMENT' literals are
+// searched eight literals at a time by gathering their values (see
+// 'replacement.c').  Support is checked once when solving starts and the
+// result passed in as 'simd'.  Otherwise, or if compiled with '-DNSIMD',
+// the search falls back to the scalar loop below.  The option is disabled
+// by default, since on large instances the gathered values mostly miss
+// the cache and then the scalar loop is faster.
+//
+// The values are passed as a plain array instead of the solver, which is
+// what lets 'measures/replacement.c' link 'replacement.c' alone.
+
+#if !defined(NSIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_REPLACEMENT 16
+#endif
+
+unsigned *kissat_scalar_replacement (const signed char *values,
+				     unsigned *begin, unsigned *end);
+
+#ifdef SIMD_REPLACEMENT
+
+bool kissat_simd_replacement_supported (void);
+
+unsigned *kissat_simd_replacement (const signed char *values,
+				   unsigned *begin, unsigned *end);
+
+#endif
+
+static inline unsigned *
+kissat_find_replacement (bool simd, const signed char *values,
+			 unsigned *begin, unsigned *end)
+{
+#ifdef SIMD_REPLACEMENT
+  if (simd && end - begin >= SIMD_REPLACEMENT)
+    return kissat_simd_replacement (values, begin, end);
+#else
+  (void) simd;
+#endif
+  unsigned *p = begin;
+  while (p != end && values[*p] < 0)
+    p++;
+  return p;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "backtrack.h"
+#include "bump.h"
+#include "decide.h"
+#include "internal.h"
+#include "logging.h"
+#include "kimits.h"
+#include "print.h"
+#include "reluctant.h"
+#include "report.h"
+#include "restart.h"
+
+#include "file_utils/checkpoint.h"
+#include "parallel/share.h"
+#include "parallel/vivifier.h"
+#include "parallel/window.h"
+
+#include <inttypes.h>
+
+bool
+kissat_restarting (kissat * solver)
+{
+  assert (solver->unassigned);
+  if (!GET_OPTION (restart))
+    return false;
+  if (!solver->level)
+    return false;
+  if (kissat_synchronizing (solver))
+    return true;
+  if (CONFLICTS < solver->limits.restart.conflicts)
+    return false;
+  if (solver->stable)
+    return kissat_reluctant_triggered (&solver->reluctant);
+  const double fast = AVERAGE (fast_glue);
+  const double slow = AVERAGE (slow_glue);
+  const double margin = (100.0 + GET_OPTION (restartmargin)) / 100.0;
+  const double limit = margin * slow;
+  LOG ("restart glue limit %g = %.02f * %g (slow glue) %c %g (fast glue)",
+       limit, margin, slow,
+       (limit > fast ? '>' : limit == fast ? '=' : '<'), fast);
+  return (limit <= fast);
+}
+
+void
+kissat_update_focused_restart_limit (kissat * solver)
+{
+  assert (!solver->stable);
+  limits *limits = &solver->limits;
+  uint64_t restarts = solver->statistics.restarts;
+  uint64_t delta = GET_OPTION (restartint);
+  if (restarts)
+    delta += kissat_logn (restarts) - 1;
+  limits->restart.conflicts = CONFLICTS + delta;
+  kissat_extremely_verbose (solver,
+			    "focused restart limit at %"
+			    PRIu64 " after %" PRIu64 " conflicts ",
+			    limits->restart.conflicts, delta);
+}
+
+int
+kissat_restart (kissat * solver)
+{
+  START (restart);
+  INC (restarts);
+  if (solver->stable)
+    INC (stable_restarts);
+  else
+    INC (focused_restarts);
+  unsigned level = 0;
+  kissat_extremely_verbose (solver,
+			    "restarting after %" PRIu64 " conflicts"
+			    " (limit %" PRIu64 ")", CONFLICTS,
+			    solver->limits.restart.conflicts);
+  LOG ("restarting to level %u", level);
+  kissat_backtrack_in_consistent_state (solver, level);
+  if (!solver->stable)
+    kissat_update_focused_restart_limit (solver);
+  int res = kissat_share_clauses (solver);
+  if (!res)
+    res = kissat_share_facts (solver);
+  if (!res)
+    res = kissat_vivify_in_background (solver);
+  if (!res)
+    kissat_checkpoint (solver);
+  REPORT (1, 'R');
+  STOP (restart);
+  return res;
+}
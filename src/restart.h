@@ -0,0 +1,11 @@
+#ifndef _restart_h_INCLUDED
+#define _restart_h_INCLUDED
+
+struct kissat;
+
+bool kissat_restarting (struct kissat *);
+int kissat_restart (struct kissat *);
+
+void kissat_update_focused_restart_limit (struct kissat *);
+
+#endif
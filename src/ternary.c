@@ -0,0 +1,121 @@
+#include "ternary.h"
+
+#include "allocate.h"
+#include "inline.h"
+#include "print.h"
+
+#include <string.h>
+
+static void
+enlarge_ternary_watches (kissat * solver, ternary_clauses * ternary,
+			 unsigned size)
+{
+  assert (ternary->size < size);
+  ternary->watches = kissat_nrealloc (solver, ternary->watches,
+				      ternary->size, size,
+				      sizeof *ternary->watches);
+  memset (ternary->watches + ternary->size, 0,
+	  (size - ternary->size) * sizeof *ternary->watches);
+  ternary->size = size;
+}
+
+static void
+push_ternary_watch (kissat * solver, ternary_clauses * ternary,
+		    unsigned lit, unsigned first, unsigned second,
+		    reference ref)
+{
+  assert (lit < ternary->size);
+  const ternary_watch watch = {.lits = {first, second},.ref = ref };
+  PUSH_STACK (ternary->watches[lit], watch);
+}
+
+static void
+watch_ternary_clause (kissat * solver, ternary_clauses * ternary,
+		      const clause * c, reference ref)
+{
+  assert (kissat_ternary_clause (c));
+  const unsigned *const lits = c->lits;
+  const unsigned lit0 = lits[0], lit1 = lits[1], lit2 = lits[2];
+  push_ternary_watch (solver, ternary, lit0, lit1, lit2, ref);
+  push_ternary_watch (solver, ternary, lit1, lit0, lit2, ref);
+  push_ternary_watch (solver, ternary, lit2, lit0, lit1, ref);
+}
+
+void
+kissat_watch_ternary_clause (kissat * solver, reference ref)
+{
+  ternary_clauses *const ternary = solver->ternary;
+  if (!ternary)
+    return;
+  const clause *const c = kissat_dereference_clause (solver, ref);
+  if (!kissat_ternary_clause (c))
+    return;
+  if (ternary->size < LITS)
+    enlarge_ternary_watches (solver, ternary, LITS);
+  LOGREF (ref, "watching ternary");
+  watch_ternary_clause (solver, ternary, c, ref);
+}
+
+void
+kissat_flush_ternary_clauses (kissat * solver)
+{
+  ternary_clauses *const ternary = solver->ternary;
+  if (!ternary)
+    return;
+  LOG ("flushing ternary clause watches");
+  for (unsigned lit = 0; lit < ternary->size; lit++)
+    CLEAR_STACK (ternary->watches[lit]);
+}
+
+void
+kissat_watch_ternary_clauses (kissat * solver)
+{
+  ternary_clauses *const ternary = solver->ternary;
+  if (!ternary)
+    return;
+  assert (solver->watching);
+  kissat_flush_ternary_clauses (solver);
+  if (ternary->size < LITS)
+    enlarge_ternary_watches (solver, ternary, LITS);
+  ward *const arena = BEGIN_STACK (solver->arena);
+  size_t watched = 0;
+  for (all_clauses (c))
+    {
+      if (c->garbage)
+	continue;
+      if (!kissat_ternary_clause (c))
+	continue;
+      watch_ternary_clause (solver, ternary, c, (ward *) c - arena);
+      watched++;
+    }
+  LOG ("watching %zu ternary clauses", watched);
+}
+
+void
+kissat_init_ternary (kissat * solver)
+{
+  if (!GET_OPTION (ternary))
+    return;
+  if (!solver->watching)
+    return;
+  if (solver->counters)
+    return;
+  assert (!solver->ternary);
+  solver->ternary = kissat_calloc (solver, 1, sizeof *solver->ternary);
+  kissat_tag_separate_watches (solver);
+  kissat_watch_ternary_clauses (solver);
+}
+
+void
+kissat_release_ternary (kissat * solver)
+{
+  ternary_clauses *const ternary = solver->ternary;
+  if (!ternary)
+    return;
+  for (unsigned lit = 0; lit < ternary->size; lit++)
+    RELEASE_STACK (ternary->watches[lit]);
+  kissat_dealloc (solver, ternary->watches, ternary->size,
+		  sizeof *ternary->watches);
+  kissat_free (solver, ternary, sizeof *ternary);
+  solver->ternary = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef _ternary_h_INCLUDED
+#define _ternary_h_INCLUDED
+
+#include "clause.h"
+#include "reference.h"
+#include "stack.h"
+
+#include <stdbool.h>
+
+// Ternary clauses are propagated through their own watch lists (enabled
+// by '--ternary').  Every ternary clause is watched by all its three
+// literals and each of these watches keeps the two other literals inline,
+// so that propagating a literal only needs to dereference the clause in
+// the arena if it actually becomes a reason or conflict (or turns out to
+// be garbage, which is only checked then).  Since no watch ever has to be
+// moved, the order of literals in the arena does not matter.
+//
+// The clauses stay in the arena and keep their regular watches, so that
+// analysis, reduction, inprocessing and proofs treat them as before, but
+// the head of these regular watches is tagged with 'separate' and skipped
+// during propagation (see 'kissat_push_blocking_watch' in 'inline.h'),
+// except for root-level units, which still move them.
+// Clauses shrunken in place to three literals are not considered ternary
+// (until they are moved during garbage collection), as literals of their
+// regular watches are not updated on the fly.  The ternary watches are
+// rebuilt whenever the arena is collected or all large clauses are
+// watched again and flushed together with large clause watches.
+
+typedef struct ternary_clauses ternary_clauses;
+typedef struct ternary_watch ternary_watch;
+
+struct ternary_watch
+{
+  unsigned lits[2];
+  reference ref;
+};
+
+// *INDENT-OFF*
+typedef STACK (ternary_watch) ternary_watches;
+// *INDENT-ON*
+
+struct ternary_clauses
+{
+  unsigned size;
+  ternary_watches *watches;
+};
+
+struct kissat;
+
+static inline bool
+kissat_ternary_clause (const clause * c)
+{
+  return c->size == 3 && !c->shrunken;
+}
+
+void kissat_init_ternary (struct kissat *);
+void kissat_release_ternary (struct kissat *);
+
+void kissat_watch_ternary_clause (struct kissat *, reference);
+void kissat_watch_ternary_clauses (struct kissat *);
+void kissat_flush_ternary_clauses (struct kissat *);
+
+#endif
@@ -0,0 +1,232 @@
+#define INLINE_SORT
+
+#include "inline.h"
+#include "sort.c"
+
+void
+kissat_remove_blocking_watch (kissat * solver,
+			      watches * watches, reference ref)
+{
+  assert (solver->watching);
+  watch *const begin = BEGIN_WATCHES (*watches);
+  watch *const end = END_WATCHES (*watches);
+  watch *q = begin;
+  watch const *p = q;
+#ifndef NDEBUG
+  bool found = false;
+#endif
+  while (p != end)
+    {
+      const watch head = *q++ = *p++;
+      if (head.type.binary)
+	continue;
+      const watch tail = *q++ = *p++;
+      if (tail.raw != ref)
+	continue;
+#ifndef NDEBUG
+      assert (!found);
+      found = true;
+#endif
+      q -= 2;
+    }
+  assert (found);
+#ifdef COMPACT
+  watches->size -= 2;
+#else
+  assert (begin + 2 <= end);
+  watches->end -= 2;
+#endif
+  const watch empty = {.raw = INVALID_VECTOR_ELEMENT };
+  end[-2] = end[-1] = empty;
+  assert (solver->vectors.usable < MAX_SECTOR - 2);
+  solver->vectors.usable += 2;
+  kissat_check_vectors (solver);
+}
+
+void
+kissat_substitute_large_watch (kissat * solver,
+			       watches * watches, watch src, watch dst)
+{
+  assert (!solver->watching);
+  watch *const begin = BEGIN_WATCHES (*watches);
+  const watch *const end = END_WATCHES (*watches);
+#ifndef NDEBUG
+  bool found = false;
+#endif
+  for (watch * p = begin; p != end; p++)
+    {
+      const watch head = *p;
+      if (head.raw != src.raw)
+	continue;
+#ifndef NDEBUG
+      found = true;
+#endif
+      *p = dst;
+      break;
+    }
+  assert (found);
+}
+
+void
+kissat_flush_large_watches (kissat * solver)
+{
+  assert (solver->watching);
+  LOG ("flush large clause watches");
+  watches *all_watches = solver->watches;
+  for (all_literals (lit))
+    {
+      watches *lit_watches = all_watches + lit;
+      watch *begin = BEGIN_WATCHES (*lit_watches), *q = begin;
+      const watch *const end = END_WATCHES (*lit_watches), *p = q;
+      while (p != end)
+	if (!(*q++ = *p++).type.binary)
+	  q--;
+      SET_END_OF_WATCHES (*lit_watches, q);
+      solver->binaries[lit] = q - begin;
+    }
+  kissat_flush_ternary_clauses (solver);
+  kissat_flush_counters (solver);
+}
+
+// Watch lists rewritten as a whole still have their binary watches in
+// front, but their numbers have to be counted again.
+
+void
+kissat_recount_binary_watches (kissat * solver)
+{
+  assert (solver->watching);
+  unsigned *const binaries = solver->binaries;
+  for (all_literals (lit))
+    {
+      const watches *const watches = &WATCHES (lit);
+      const watch *const begin = BEGIN_CONST_WATCHES (*watches);
+      const watch *const end = END_CONST_WATCHES (*watches);
+      const watch *p = begin;
+      while (p != end && p->type.binary)
+	p++;
+      binaries[lit] = p - begin;
+      assert (kissat_binary_watches_counted (solver, lit));
+    }
+}
+
+void
+kissat_watch_large_clauses (kissat * solver)
+{
+  LOG ("watching all large clauses");
+  assert (solver->watching);
+
+  const value *const values = solver->values;
+  const assigned *const assigned = solver->assigned;
+  watches *watches = solver->watches;
+  ward *const arena = BEGIN_STACK (solver->arena);
+
+  for (all_clauses (c))
+    {
+      if (c->garbage)
+	continue;
+
+      unsigned *lits = c->lits;
+      kissat_sort_literals (solver, values, assigned, c->size, lits);
+      c->searched = 2;
+
+      const reference ref = (ward *) c - arena;
+      const unsigned l0 = lits[0];
+      const unsigned l1 = lits[1];
+
+      kissat_push_blocking_watch (solver, watches + l0, l1, ref);
+      kissat_push_blocking_watch (solver, watches + l1, l0, ref);
+    }
+  kissat_recount_binary_watches (solver);
+  kissat_watch_ternary_clauses (solver);
+  kissat_count_clauses (solver);
+}
+
+// Before ternary watches or counters are initialized regular watches were
+// pushed without the 'separate' tag, so these are tagged here once.
+
+void
+kissat_tag_separate_watches (kissat * solver)
+{
+  watches *const all_watches = solver->watches;
+  ward *const arena = BEGIN_STACK (solver->arena);
+  for (all_literals (lit))
+    {
+      watches *const watches = all_watches + lit;
+      watch *p = BEGIN_WATCHES (*watches);
+      const watch *const end = END_WATCHES (*watches);
+      while (p != end)
+	{
+	  watch *const head = p++;
+	  if (head->type.binary)
+	    continue;
+	  const reference ref = (p++)->large.ref;
+	  const clause *const c = (clause *) (arena + ref);
+	  head->blocking.separate = kissat_separate_clause (solver, c);
+	}
+    }
+}
+
+void
+kissat_connect_irredundant_large_clauses (kissat * solver)
+{
+  assert (!solver->watching);
+  LOG ("connecting all large irredundant clauses");
+
+  clause *last_irredundant = kissat_last_irredundant_clause (solver);
+
+  const value *const values = solver->values;
+  watches *all_watches = solver->watches;
+  ward *const arena = BEGIN_STACK (solver->arena);
+
+  for (all_clauses (c))
+    {
+      if (last_irredundant && c > last_irredundant)
+	break;
+      if (c->redundant)
+	continue;
+      if (c->garbage)
+	continue;
+      bool satisfied = false;
+      assert (!solver->level);
+      for (all_literals_in_clause (lit, c))
+	{
+	  const value value = values[lit];
+	  if (value <= 0)
+	    continue;
+	  satisfied = true;
+	  break;
+	}
+      if (satisfied)
+	{
+	  kissat_mark_clause_as_garbage (solver, c);
+	  continue;
+	}
+      const reference ref = (ward *) c - arena;
+      kissat_inlined_connect_clause (solver, all_watches, c, ref);
+    }
+}
+
+void
+kissat_flush_large_connected (kissat * solver)
+{
+  assert (!solver->watching);
+  LOG ("flushing large connected clause references");
+  size_t flushed = 0;
+  for (all_literals (lit))
+    {
+      watches *watches = &WATCHES (lit);
+      watch *begin = BEGIN_WATCHES (*watches), *q = begin;
+      const watch *const end_watches = END_WATCHES (*watches), *p = q;
+      while (p != end_watches)
+	{
+	  const watch head = *p++;
+	  if (head.type.binary)
+	    *q++ = head;
+	  else
+	    flushed++;
+	}
+      SET_END_OF_WATCHES (*watches, q);
+    }
+  LOG ("flushed %zu large clause references", flushed);
+  (void) flushed;
+}